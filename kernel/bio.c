@@ -7,6 +7,7 @@
 //
 // Interface:
 // * To get a buffer for a particular disk block, call bread.
+// * To get one that will be completely overwritten, call bfresh.
 // * After changing buffer data, call bwrite to write it to disk.
 // * When done with the buffer, call brelse.
 // * Do not use the buffer after calling brelse.
@@ -105,6 +106,19 @@ bread(uint dev, uint blockno)
   return b;
 }
 
+// Return a locked buf for the indicated block without reading
+// it from disk, for a caller that will overwrite all of it.
+// The contents are whatever the buffer last held.
+struct buf*
+bfresh(uint dev, uint blockno)
+{
+  struct buf *b;
+
+  b = bget(dev, blockno);
+  b->flags |= B_VALID;
+  return b;
+}
+
 // Write b's contents to disk.  Must be locked.
 void
 bwrite(struct buf *b)
@@ -25,7 +25,7 @@ static struct {
 } cons;
 
 static void
-printint(int xx, int base, int sign)
+printint(void (*putc)(int, void*), void *arg, int xx, int base, int sign)
 {
   static char digits[] = "0123456789abcdef";
   char buf[16];
@@ -46,29 +46,24 @@ printint(int xx, int base, int sign)
     buf[i++] = '-';
 
   while(--i >= 0)
-    consputc(buf[i]);
+    putc(buf[i], arg);
 }
 //PAGEBREAK: 50
 
-// Print to the console. only understands %d, %x, %p, %s.
+// Format fmt with the arguments at argp, handing each output
+// character to putc.  Only understands %d, %x, %p, %s.
 void
-cprintf(char *fmt, ...)
+vprintfmt(void (*putc)(int, void*), void *arg, char *fmt, uint *argp)
 {
-  int i, c, locking;
-  uint *argp;
+  int i, c;
   char *s;
 
-  locking = cons.locking;
-  if(locking)
-    acquire(&cons.lock);
-
   if (fmt == 0)
     panic("null fmt");
 
-  argp = (uint*)(void*)(&fmt + 1);
   for(i = 0; (c = fmt[i] & 0xff) != 0; i++){
     if(c != '%'){
-      consputc(c);
+      putc(c, arg);
       continue;
     }
     c = fmt[++i] & 0xff;
@@ -76,28 +71,47 @@ cprintf(char *fmt, ...)
       break;
     switch(c){
     case 'd':
-      printint(*argp++, 10, 1);
+      printint(putc, arg, *argp++, 10, 1);
       break;
     case 'x':
     case 'p':
-      printint(*argp++, 16, 0);
+      printint(putc, arg, *argp++, 16, 0);
       break;
     case 's':
       if((s = (char*)*argp++) == 0)
         s = "(null)";
       for(; *s; s++)
-        consputc(*s);
+        putc(*s, arg);
       break;
     case '%':
-      consputc('%');
+      putc('%', arg);
       break;
     default:
       // Print unknown % sequence to draw attention.
-      consputc('%');
-      consputc(c);
+      putc('%', arg);
+      putc(c, arg);
       break;
     }
   }
+}
+
+static void
+cputc(int c, void *arg)
+{
+  consputc(c);
+}
+
+// Print to the console. only understands %d, %x, %p, %s.
+void
+cprintf(char *fmt, ...)
+{
+  int locking;
+
+  locking = cons.locking;
+  if(locking)
+    acquire(&cons.lock);
+
+  vprintfmt(cputc, 0, fmt, (uint*)(void*)(&fmt + 1));
 
   if(locking)
     release(&cons.lock);
@@ -171,7 +185,10 @@ consputc(int c)
       ;
   }
 
-  if(c == BACKSPACE){
+  // While panicking, bypass the UART's lock and ring.
+  if(!cons.locking)
+    uartputc_sync(c == BACKSPACE ? '\b' : c);
+  else if(c == BACKSPACE){
     uartputc('\b'); uartputc(' '); uartputc('\b');
   } else
     uartputc(c);
@@ -273,16 +290,30 @@ consoleread(struct inode *ip, char *dst, int n)
 int
 consolewrite(struct inode *ip, char *buf, int n)
 {
-  int i;
+  int i, j, m;
 
   iunlock(ip);
-  acquire(&cons.lock);
-  for(i = 0; i < n; i++)
-    consputc(buf[i] & 0xff);
-  release(&cons.lock);
+  // Queue as much as the UART ring has room for, reserving it
+  // under the ring's lock, and sleep (with cons.lock released)
+  // while the ring is full rather than polling the UART.  Other
+  // output may come between these chunks.
+  for(i = 0; i < n; i += m){
+    acquire(&cons.lock);
+    if(panicked){
+      cli();
+      for(;;)
+        ;
+    }
+    m = uartputs(buf + i, n - i);
+    for(j = 0; j < m; j++)
+      cgaputc(buf[i+j] & 0xff);
+    release(&cons.lock);
+    if(m == 0 && uartwait() < 0)
+      break;
+  }
   ilock(ip);
 
-  return n;
+  return i == 0 && n > 0 ? -1 : i;
 }
 
 void
@@ -0,0 +1,181 @@
+// Directory entry cache.
+//
+// namex() looks up each path component with ilock() and
+// dirlookup(), reading directory blocks every time even for
+// hot paths like /sh.  The dcache remembers the result of
+// recent lookups as (dev, directory inum, name) -> inum, with
+// inum 0 recording that the name is absent, so namex() can
+// step through a cached component without locking the
+// directory or touching the buffer cache.
+//
+// Entries are only inserted or changed while the directory's
+// sleep-lock is held (by dirlookup, dirlink and dirunlink),
+// so the cache always agrees with the directory contents.
+// When a directory is freed its entries are purged, since
+// its inode number may be reused.
+//
+// The cache is a fixed array of NDENTRY entries hashed into
+// buckets, with an LRU list for reuse like the buffer cache.
+// dcache.lock protects everything; it is acquired before
+// icache.lock, in dcache_lookup().
+
+#include "types.h"
+#include "defs.h"
+#include "param.h"
+#include "spinlock.h"
+#include "sleeplock.h"
+#include "fs.h"
+#include "file.h"
+
+#define NDHASH 64
+
+struct dentry {
+  uint dev;
+  uint dir;                 // inum of the directory; 0 if unused
+  char name[DIRSIZ];
+  uint inum;                // entry's inum, or 0 if name is absent
+  struct dentry *hnext;     // hash chain
+  struct dentry *prev;      // LRU list
+  struct dentry *next;
+};
+
+struct {
+  struct spinlock lock;
+  struct dentry dentry[NDENTRY];
+  struct dentry *hash[NDHASH];
+
+  // Linked list of all entries, through prev/next.
+  // head.next is most recently used.
+  struct dentry head;
+} dcache;
+
+void
+dcacheinit(void)
+{
+  struct dentry *d;
+
+  initlock(&dcache.lock, "dcache");
+  dcache.head.prev = &dcache.head;
+  dcache.head.next = &dcache.head;
+  for(d = dcache.dentry; d < dcache.dentry+NDENTRY; d++){
+    d->next = dcache.head.next;
+    d->prev = &dcache.head;
+    dcache.head.next->prev = d;
+    dcache.head.next = d;
+  }
+}
+
+static struct dentry**
+bucket(uint dev, uint dir, char *name)
+{
+  return &dcache.hash[(namehash(name) + dir*31 + dev) % NDHASH];
+}
+
+// Find the entry for name in directory dir.
+// Caller must hold dcache.lock.
+static struct dentry*
+dfind(uint dev, uint dir, char *name)
+{
+  struct dentry *d;
+
+  for(d = *bucket(dev, dir, name); d; d = d->hnext)
+    if(d->dev == dev && d->dir == dir && namecmp(name, d->name) == 0)
+      return d;
+  return 0;
+}
+
+// Move d to the front of the LRU list.
+static void
+touch(struct dentry *d)
+{
+  d->next->prev = d->prev;
+  d->prev->next = d->next;
+  d->next = dcache.head.next;
+  d->prev = &dcache.head;
+  dcache.head.next->prev = d;
+  dcache.head.next = d;
+}
+
+// Remove d from its hash chain and mark it unused.
+static void
+unhash(struct dentry *d)
+{
+  struct dentry **pp;
+
+  if(d->dir == 0)
+    return;
+  for(pp = bucket(d->dev, d->dir, d->name); *pp != d; pp = &(*pp)->hnext)
+    ;
+  *pp = d->hnext;
+  d->dir = 0;
+}
+
+// Look up name in directory dp, which need not be locked.
+// Returns 1 if the cache knows the answer, setting *ipp to a
+// referenced inode for the entry or to 0 if name is absent,
+// and returns 0 if the caller must search dp itself.
+int
+dcache_lookup(struct inode *dp, char *name, struct inode **ipp)
+{
+  struct dentry *d;
+
+  acquire(&dcache.lock);
+  if((d = dfind(dp->dev, dp->inum, name)) == 0){
+    release(&dcache.lock);
+    return 0;
+  }
+  touch(d);
+  // Take the reference before releasing dcache.lock, so that
+  // the entry cannot be unlinked and its inode freed first.
+  *ipp = d->inum ? iget(dp->dev, d->inum) : 0;
+  release(&dcache.lock);
+  return 1;
+}
+
+// Record that name in directory dp refers to inum, or is
+// absent if inum is 0.  Caller must hold dp->lock.
+void
+dcache_enter(struct inode *dp, char *name, uint inum)
+{
+  struct dentry *d, **b;
+
+  acquire(&dcache.lock);
+  if((d = dfind(dp->dev, dp->inum, name)) == 0){
+    // Recycle the least recently used entry.
+    d = dcache.head.prev;
+    unhash(d);
+    d->dev = dp->dev;
+    d->dir = dp->inum;
+    strncpy(d->name, name, DIRSIZ);
+    b = bucket(d->dev, d->dir, d->name);
+    d->hnext = *b;
+    *b = d;
+  }
+  d->inum = inum;
+  touch(d);
+  release(&dcache.lock);
+}
+
+// Forget everything about inode inum on dev, which is being
+// freed: the entries of the directory it was, and any entry
+// still naming it.
+void
+dcache_purge(uint dev, uint inum)
+{
+  struct dentry *d;
+
+  acquire(&dcache.lock);
+  for(d = dcache.dentry; d < dcache.dentry+NDENTRY; d++){
+    if(d->dir != 0 && d->dev == dev && (d->dir == inum || d->inum == inum)){
+      unhash(d);
+      // Reuse purged entries first.
+      d->next->prev = d->prev;
+      d->prev->next = d->next;
+      d->prev = dcache.head.prev;
+      d->next = &dcache.head;
+      dcache.head.prev->next = d;
+      dcache.head.prev = d;
+    }
+  }
+  release(&dcache.lock);
+}
@@ -1,7 +1,13 @@
 struct buf;
 struct context;
 struct file;
+struct iovec;
+struct klogrec;
 struct inode;
+struct lockstat;
+struct profsample;
+struct sysstat;
+struct systrace;
 struct pipe;
 struct proc;
 struct rtcdate;
@@ -9,10 +15,12 @@ struct spinlock;
 struct sleeplock;
 struct stat;
 struct superblock;
+struct trapframe;
 
 // bio.c
 void            binit(void);
 struct buf*     bread(uint, uint);
+struct buf*     bfresh(uint, uint);
 void            brelse(struct buf*);
 void            bwrite(struct buf*);
 
@@ -21,6 +29,21 @@ void            consoleinit(void);
 void            cprintf(char*, ...);
 void            consoleintr(int(*)(void));
 void            panic(char*) __attribute__((noreturn));
+void            vprintfmt(void(*)(int, void*), void*, char*, uint*);
+
+// dcache.c
+void            dcacheinit(void);
+int             dcache_lookup(struct inode*, char*, struct inode**);
+void            dcache_enter(struct inode*, char*, uint);
+void            dcache_purge(uint, uint);
+
+// dirhash.c
+uint            namehash(char*);
+int             dirhash_lookup(struct inode*, char*, uint*, uint*);
+uint            dirhash_freeoff(struct inode*);
+void            dirhash_add(struct inode*, char*, uint);
+void            dirhash_remove(struct inode*, char*, uint);
+void            dirhash_free(struct inode*);
 
 // exec.c
 int             exec(char*, char**);
@@ -29,17 +52,25 @@ int             exec(char*, char**);
 struct file*    filealloc(void);
 void            fileclose(struct file*);
 struct file*    filedup(struct file*);
+int             filefcntl(struct file*, int, int);
+int             filesplice(struct file*, struct file*, int);
+int             filecopy(struct file*, struct file*, uint, int);
 void            fileinit(void);
 int             fileread(struct file*, char*, int n);
+int             filereadv(struct file*, struct iovec*, int, int);
 int             filestat(struct file*, struct stat*);
 int             filewrite(struct file*, char*, int n);
+int             filewritev(struct file*, struct iovec*, int, int);
 
 // fs.c
 void            readsb(int dev, struct superblock *sb);
+void            allocinit(int);
 int             dirlink(struct inode*, char*, uint);
 struct inode*   dirlookup(struct inode*, char*, uint*);
-struct inode*   ialloc(uint, short);
+void            dirunlink(struct inode*, char*, uint);
+struct inode*   ialloc(uint, short, uint);
 struct inode*   idup(struct inode*);
+struct inode*   iget(uint, uint);
 void            iinit(int dev);
 void            ilock(struct inode*);
 void            iput(struct inode*);
@@ -52,6 +83,8 @@ struct inode*   nameiparent(char*, char*);
 int             readi(struct inode*, char*, uint, uint);
 void            stati(struct inode*, struct stat*);
 int             writei(struct inode*, char*, uint, uint);
+int             copyi(struct inode*, uint, struct inode*, uint, uint);
+short           itype(struct inode*);
 
 // ide.c
 void            ideinit(void);
@@ -72,6 +105,12 @@ void            kinit2(void*, void*);
 // kbd.c
 void            kbdintr(void);
 
+// klog.c
+void            klog(char*, ...);
+int             klogread(uint, struct klogrec*, int);
+int             klogctl(int, uint);
+void            klogflush(void);
+
 // lapic.c
 void            cmostime(struct rtcdate *r);
 int             lapicid(void);
@@ -85,7 +124,12 @@ void            microdelay(int);
 void            initlog(int dev);
 void            log_write(struct buf*);
 void            begin_op();
+void            begin_op_reserve(int);
+void            end_op_defer(void*);
+int             log_maxop(void);
 void            end_op();
+void            logflusher(void);
+void            logtick(uint);
 
 // mp.c
 extern int      ismp;
@@ -100,13 +144,28 @@ int             pipealloc(struct file**, struct file**);
 void            pipeclose(struct pipe*, int);
 int             piperead(struct pipe*, char*, int);
 int             pipewrite(struct pipe*, char*, int);
+int             pipecanread(struct pipe*);
+int             pipegetsize(struct pipe*);
+int             pipesetsize(struct pipe*, int);
+int             pipewbegin(struct pipe*, char**, int);
+void            pipewend(struct pipe*, int);
+int             piperbegin(struct pipe*, char**, int);
+void            piperend(struct pipe*, int);
 
 //PAGEBREAK: 16
+// prof.c
+void            profinit(void);
+void            profsample(struct trapframe*);
+int             profctl(int);
+int             profread(struct profsample*, int);
+
 // proc.c
 int             cpuid(void);
 void            exit(void);
 int             fork(void);
 int             growproc(int);
+int             growofile(struct proc*);
+void            kproc(char*, void(*)(void));
 int             kill(int);
 struct cpu*     mycpu(void);
 struct proc*    myproc();
@@ -124,6 +183,8 @@ void            tick_accounting(void);
 int             waitx(int *wtime, int *rtime);
 int             setgroup_k(int pid, int gid);
 int             getgroup_k(int pid);
+int             trace(int);
+int             sysstat(int, struct sysstat*);
 
 // swtch.S
 void            swtch(struct context**, struct context*);
@@ -133,6 +194,7 @@ void            acquire(struct spinlock*);
 void            getcallerpcs(void*, uint*);
 int             holding(struct spinlock*);
 void            initlock(struct spinlock*, char*);
+int             lockstats(struct lockstat*, int);
 void            release(struct spinlock*);
 void            pushcli(void);
 void            popcli(void);
@@ -160,6 +222,14 @@ int             fetchint(uint, int*);
 int             fetchstr(uint, char**);
 void            syscall(void);
 
+// systrace.c
+void            systrace(struct proc*, int, uint);
+struct systrace* systrace_alloc(void);
+struct systrace* systrace_dup(struct systrace*);
+void            systrace_put(struct systrace*);
+void            systrace_read(struct systrace*, struct sysstat*);
+int             readcount(void);
+
 // timer.c
 void            timerinit(void);
 
@@ -173,6 +243,14 @@ extern struct spinlock tickslock;
 void            uartinit(void);
 void            uartintr(void);
 void            uartputc(int);
+void            uartputc_sync(int);
+int             uartputs(char*, int);
+int             uartwait(void);
+
+// vdso.c
+void            vdsoinit(void);
+void            vdsotick(uint);
+int             mapvdso(pde_t*, int);
 
 // vm.c
 void            seginit(void);
@@ -182,6 +260,7 @@ char*           uva2ka(pde_t*, char*);
 int             allocuvm(pde_t*, uint, uint);
 int             deallocuvm(pde_t*, uint, uint);
 void            freevm(pde_t*);
+int             mapupage(pde_t*, uint, char*, int);
 void            inituvm(pde_t*, char*, uint);
 int             loaduvm(pde_t*, char*, struct inode*, uint, uint);
 pde_t*          copyuvm(pde_t*, uint);
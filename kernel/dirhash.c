@@ -0,0 +1,288 @@
+// In-memory hash index over the entries of a large directory.
+//
+// dirlookup() and dirlink() scan a directory linearly, which
+// makes creating or opening files in a directory with thousands
+// of entries quadratic.  Once a directory grows past
+// DIRHASH_MIN entries, the first lookup reads it once and builds
+// an open-addressing table mapping name hashes to entry numbers.
+// Lookups then read only the entries whose full hash matches,
+// and a free-entry hint lets dirlink() skip the in-use prefix.
+//
+// The index is a cache: it is not stored on disk, it is dropped
+// when its inode leaves the inode cache or is freed, and a
+// directory without one is simply scanned as before.  All
+// routines must be called with dp->lock held, which protects
+// dp->dirhash along with the rest of the inode.
+
+#include "types.h"
+#include "defs.h"
+#include "param.h"
+#include "stat.h"
+#include "mmu.h"
+#include "spinlock.h"
+#include "sleeplock.h"
+#include "fs.h"
+#include "file.h"
+
+#define DIRHASH_MIN      128  // smallest directory (entries) worth indexing
+#define DIRHASH_MAXPAGES 32   // table pages per directory
+
+#define EMPTY  0              // slot.ent values; others are entry number + 1
+#define DELETED 0xffffffff
+
+struct slot {
+  uint hash;                  // namehash() of the entry's name
+  uint ent;                   // entry number + 1, EMPTY or DELETED
+};
+
+#define SLOTSPERPAGE (PGSIZE / sizeof(struct slot))
+#define DIRHASH_MAXENT (DIRHASH_MAXPAGES * SLOTSPERPAGE / 2)
+
+// Index header; occupies its own page.
+struct dirhash {
+  uint nslot;                 // table size, a power of two
+  uint nused;                 // live and deleted slots
+  uint freeoff;               // no free entry before this offset
+  struct slot *page[DIRHASH_MAXPAGES];
+};
+
+// Hash a directory entry name (FNV-1a over at most DIRSIZ bytes).
+uint
+namehash(char *name)
+{
+  uint h;
+  int i;
+
+  h = 2166136261U;
+  for(i = 0; i < DIRSIZ && name[i]; i++){
+    h ^= (uchar)name[i];
+    h *= 16777619;
+  }
+  return h;
+}
+
+static struct slot*
+slotat(struct dirhash *dh, uint i)
+{
+  return &dh->page[i / SLOTSPERPAGE][i % SLOTSPERPAGE];
+}
+
+static void
+freetable(struct dirhash *dh)
+{
+  int i;
+
+  for(i = 0; i < DIRHASH_MAXPAGES; i++)
+    if(dh->page[i])
+      kfree((char*)dh->page[i]);
+}
+
+// Allocate a header and an empty table of nslot slots.
+static struct dirhash*
+allocdh(uint nslot)
+{
+  struct dirhash *dh;
+  uint i, npage;
+
+  if((dh = (struct dirhash*)kalloc()) == 0)
+    return 0;
+  memset(dh, 0, sizeof(*dh));
+  dh->nslot = nslot;
+  npage = (nslot + SLOTSPERPAGE - 1) / SLOTSPERPAGE;
+  for(i = 0; i < npage; i++){
+    if((dh->page[i] = (struct slot*)kalloc()) == 0){
+      freetable(dh);
+      kfree((char*)dh);
+      return 0;
+    }
+    memset(dh->page[i], 0, PGSIZE);
+  }
+  return dh;
+}
+
+// Insert entry number ent with the given hash; the table
+// must have a free slot.
+static void
+insert(struct dirhash *dh, uint hash, uint ent)
+{
+  struct slot *s;
+  uint i;
+
+  for(i = hash & (dh->nslot - 1); ; i = (i + 1) & (dh->nslot - 1)){
+    s = slotat(dh, i);
+    if(s->ent == EMPTY || s->ent == DELETED){
+      if(s->ent == EMPTY)
+        dh->nused++;
+      s->hash = hash;
+      s->ent = ent + 1;
+      return;
+    }
+  }
+}
+
+// Smallest table that holds n live entries at most half full.
+static uint
+tablesize(uint n)
+{
+  uint nslot;
+
+  for(nslot = SLOTSPERPAGE; nslot < 2*n; nslot *= 2)
+    ;
+  return nslot;
+}
+
+// Drop dp's index, if it has one.
+void
+dirhash_free(struct inode *dp)
+{
+  struct dirhash *dh;
+
+  if((dh = dp->dirhash) == 0)
+    return;
+  dp->dirhash = 0;
+  freetable(dh);
+  kfree((char*)dh);
+}
+
+// Build an index for dp from its on-disk entries.
+static struct dirhash*
+build(struct inode *dp)
+{
+  struct dirhash *dh;
+  struct dirent de;
+  uint off, n;
+
+  n = dp->size / sizeof(de);
+  if((dh = allocdh(tablesize(n))) == 0)
+    return 0;
+  dh->freeoff = dp->size;
+  for(off = 0; off < dp->size; off += sizeof(de)){
+    if(readi(dp, (char*)&de, off, sizeof(de)) != sizeof(de))
+      panic("dirhash build");
+    if(de.inum == 0){
+      if(off < dh->freeoff)
+        dh->freeoff = off;
+      continue;
+    }
+    insert(dh, namehash(de.name), off / sizeof(de));
+  }
+  dp->dirhash = dh;
+  return dh;
+}
+
+// Return dp's index, building it if dp is large enough,
+// or 0 if dp should be scanned linearly.
+static struct dirhash*
+getdh(struct inode *dp)
+{
+  uint n;
+
+  n = dp->size / sizeof(struct dirent);
+  if(dp->dirhash)
+    return dp->dirhash;
+  if(n < DIRHASH_MIN || n > DIRHASH_MAXENT)
+    return 0;
+  return build(dp);
+}
+
+// Look up name in dp's index.  Returns 1 and sets *poff and
+// *pinum if found, 0 if not present, -1 if dp has no index.
+int
+dirhash_lookup(struct inode *dp, char *name, uint *poff, uint *pinum)
+{
+  struct dirhash *dh;
+  struct dirent de;
+  struct slot *s;
+  uint h, i, off;
+
+  if((dh = getdh(dp)) == 0)
+    return -1;
+  h = namehash(name);
+  for(i = h & (dh->nslot - 1); ; i = (i + 1) & (dh->nslot - 1)){
+    s = slotat(dh, i);
+    if(s->ent == EMPTY)
+      return 0;
+    if(s->ent == DELETED || s->hash != h)
+      continue;
+    off = (s->ent - 1) * sizeof(de);
+    if(readi(dp, (char*)&de, off, sizeof(de)) != sizeof(de))
+      panic("dirhash lookup");
+    if(de.inum != 0 && namecmp(name, de.name) == 0){
+      *poff = off;
+      *pinum = de.inum;
+      return 1;
+    }
+  }
+}
+
+// Return the offset at which dirlink() should start
+// looking for a free entry in dp.
+uint
+dirhash_freeoff(struct inode *dp)
+{
+  struct dirhash *dh;
+
+  if((dh = getdh(dp)) == 0)
+    return 0;
+  return dh->freeoff;
+}
+
+// Record that the entry at off in dp now holds name.
+void
+dirhash_add(struct inode *dp, char *name, uint off)
+{
+  struct dirhash *dh, *ndh;
+  struct slot *s;
+  uint i, n;
+
+  if((dh = dp->dirhash) == 0)
+    return;
+  // dirlink() used the first free entry at or after freeoff.
+  if(off >= dh->freeoff)
+    dh->freeoff = off + sizeof(struct dirent);
+
+  // Keep the table at most half full, counting deleted
+  // slots; rehash into a fresh (perhaps larger) table.
+  if(2*(dh->nused + 1) > dh->nslot){
+    n = dp->size / sizeof(struct dirent);
+    if(n > DIRHASH_MAXENT || (ndh = allocdh(tablesize(n))) == 0){
+      dirhash_free(dp);
+      return;
+    }
+    ndh->freeoff = dh->freeoff;
+    for(i = 0; i < dh->nslot; i++){
+      s = slotat(dh, i);
+      if(s->ent != EMPTY && s->ent != DELETED)
+        insert(ndh, s->hash, s->ent - 1);
+    }
+    dirhash_free(dp);
+    dp->dirhash = dh = ndh;
+  }
+  insert(dh, namehash(name), off / sizeof(struct dirent));
+}
+
+// Record that the entry at off in dp, which held name,
+// has been cleared.
+void
+dirhash_remove(struct inode *dp, char *name, uint off)
+{
+  struct dirhash *dh;
+  struct slot *s;
+  uint h, i, ent;
+
+  if((dh = dp->dirhash) == 0)
+    return;
+  h = namehash(name);
+  ent = off / sizeof(struct dirent) + 1;
+  for(i = h & (dh->nslot - 1); ; i = (i + 1) & (dh->nslot - 1)){
+    s = slotat(dh, i);
+    if(s->ent == EMPTY)
+      panic("dirhash remove");
+    if(s->ent == ent){
+      s->ent = DELETED;
+      break;
+    }
+  }
+  if(off < dh->freeoff)
+    dh->freeoff = off;
+}
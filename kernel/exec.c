@@ -66,6 +66,8 @@ exec(char *path, char **argv)
   if((sz = allocuvm(pgdir, sz, sz + 2*PGSIZE)) == 0)
     goto bad;
   clearpteu(pgdir, (char*)(sz - 2*PGSIZE));
+  if(mapvdso(pgdir, curproc->pid) < 0)
+    goto bad;
   sp = sz;
 
   // Push argument strings, prepare rest of stack in ustack.
@@ -97,6 +99,7 @@ exec(char *path, char **argv)
   oldpgdir = curproc->pgdir;
   curproc->pgdir = pgdir;
   curproc->sz = sz;
+  curproc->ring = 0;  // freed with oldpgdir
   curproc->tf->eip = elf.entry;  // main
   curproc->tf->esp = sp;
   switchuvm(curproc);
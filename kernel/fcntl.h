@@ -2,3 +2,7 @@
 #define O_WRONLY  0x001
 #define O_RDWR    0x002
 #define O_CREATE  0x200
+
+// fcntl() commands
+#define F_GETPIPE_SZ 1    // pipe capacity in bytes
+#define F_SETPIPE_SZ 2    // resize pipe (rounded up); returns new capacity
@@ -5,15 +5,28 @@
 #include "types.h"
 #include "defs.h"
 #include "param.h"
+#include "stat.h"
+#include "mmu.h"
 #include "fs.h"
 #include "spinlock.h"
 #include "sleeplock.h"
 #include "file.h"
+#include "fcntl.h"
+#include "uio.h"
 
 struct devsw devsw[NDEV];
+
+// Open files are carved out of pages from kalloc() as they
+// are needed, up to NFILE, and recycled through a free list.
+// ftable.lock protects only the free list: reference counts
+// are updated atomically, so filedup() and fileclose() take
+// no lock unless the file is being freed.
+#define FILESPERPAGE (PGSIZE / sizeof(struct file))
+
 struct {
   struct spinlock lock;
-  struct file file[NFILE];
+  struct file *free;
+  int nfile;         // files carved out so far
 } ftable;
 
 void
@@ -22,6 +35,24 @@ fileinit(void)
   initlock(&ftable.lock, "ftable");
 }
 
+// Add a page of files to the free list.
+// Caller must hold ftable.lock.
+static void
+filegrow(void)
+{
+  struct file *f;
+  char *mem;
+
+  if(ftable.nfile + FILESPERPAGE > NFILE || (mem = kalloc()) == 0)
+    return;
+  memset(mem, 0, PGSIZE);
+  for(f = (struct file*)mem; f < (struct file*)mem + FILESPERPAGE; f++){
+    f->next = ftable.free;
+    ftable.free = f;
+  }
+  ftable.nfile += FILESPERPAGE;
+}
+
 // Allocate a file structure.
 struct file*
 filealloc(void)
@@ -29,26 +60,24 @@ filealloc(void)
   struct file *f;
 
   acquire(&ftable.lock);
-  for(f = ftable.file; f < ftable.file + NFILE; f++){
-    if(f->ref == 0){
-      f->ref = 1;
-      release(&ftable.lock);
-      return f;
-    }
-  }
+  if(ftable.free == 0)
+    filegrow();
+  if((f = ftable.free) != 0){
+    ftable.free = f->next;
+    f->next = 0;
+    f->ref = 1;
+  } else
+    klog("file table full (%d files)", ftable.nfile);
   release(&ftable.lock);
-  return 0;
+  return f;
 }
 
 // Increment ref count for file f.
 struct file*
 filedup(struct file *f)
 {
-  acquire(&ftable.lock);
-  if(f->ref < 1)
+  if(__sync_fetch_and_add(&f->ref, 1) < 1)
     panic("filedup");
-  f->ref++;
-  release(&ftable.lock);
   return f;
 }
 
@@ -57,17 +86,17 @@ void
 fileclose(struct file *f)
 {
   struct file ff;
+  int ref;
 
-  acquire(&ftable.lock);
-  if(f->ref < 1)
-    panic("fileclose");
-  if(--f->ref > 0){
-    release(&ftable.lock);
+  if((ref = __sync_sub_and_fetch(&f->ref, 1)) > 0)
     return;
-  }
+  if(ref < 0)
+    panic("fileclose");
   ff = *f;
-  f->ref = 0;
   f->type = FD_NONE;
+  acquire(&ftable.lock);
+  f->next = ftable.free;
+  ftable.free = f;
   release(&ftable.lock);
 
   if(ff.type == FD_PIPE)
@@ -96,62 +125,300 @@ filestat(struct file *f, struct stat *st)
 int
 fileread(struct file *f, char *addr, int n)
 {
-  int r;
+  struct iovec iov;
+
+  iov.iov_base = addr;
+  iov.iov_len = n;
+  return filereadv(f, &iov, 1, -1);
+}
+
+// Read from file f into the cnt buffers of iov in turn, at
+// offset off, or at f->off (advancing it) if off is -1.
+// Stops early at end of file, or for a pipe when it would
+// have to wait for more data after reading some.
+int
+filereadv(struct file *f, struct iovec *iov, int cnt, int off)
+{
+  int i, r, tot;
+  uint o;
 
   if(f->readable == 0)
     return -1;
-  if(f->type == FD_PIPE)
-    return piperead(f->pipe, addr, n);
+  tot = 0;
+  if(f->type == FD_PIPE){
+    if(off != -1)
+      return -1;
+    for(i = 0; i < cnt; i++){
+      if(tot > 0 && !pipecanread(f->pipe))
+        break;
+      if((r = piperead(f->pipe, iov[i].iov_base, iov[i].iov_len)) < 0)
+        return tot > 0 ? tot : -1;
+      tot += r;
+      if(r < iov[i].iov_len)
+        break;
+    }
+    return tot;
+  }
   if(f->type == FD_INODE){
     ilock(f->ip);
-    if((r = readi(f->ip, addr, f->off, n)) > 0)
-      f->off += r;
+    o = off == -1 ? f->off : off;
+    for(i = 0; i < cnt; i++){
+      if((r = readi(f->ip, iov[i].iov_base, o, iov[i].iov_len)) < 0){
+        if(tot == 0)
+          tot = -1;
+        break;
+      }
+      o += r;
+      tot += r;
+      if(r < iov[i].iov_len)
+        break;
+    }
+    if(off == -1)
+      f->off = o;
     iunlock(f->ip);
-    return r;
+    return tot;
   }
   panic("fileread");
 }
 
+// Upper bound on the number of blocks that writing n > 0 bytes
+// can modify: the data blocks it spans at the worst alignment
+// (f->off may move under a concurrent writer), up to three
+// indirect blocks (the singly- and doubly-indirect blocks and
+// the second-level blocks a chunk can straddle), a bitmap
+// block for each block it allocates, and the inode.
+static int
+writeblocks(int n)
+{
+  int nb;
+
+  nb = (n + BSIZE - 2) / BSIZE + 1;
+  return 2*nb + 2*3 + 1;
+}
+
+// Most bytes one write op may cover, given that it should
+// reserve at most log_maxop() blocks; see writeblocks.
+static int
+maxwrite(void)
+{
+  return ((log_maxop()-1-3*2-2) / 2) * BSIZE;
+}
+
 //PAGEBREAK!
 // Write to file f.
 int
 filewrite(struct file *f, char *addr, int n)
 {
-  int r;
+  struct iovec iov;
+
+  iov.iov_base = addr;
+  iov.iov_len = n;
+  return filewritev(f, &iov, 1, -1);
+}
+
+// Write the cnt buffers of iov in turn to file f, at offset
+// off, or at f->off (advancing it) if off is -1.  Returns
+// the total length, or -1 if it could not all be written.
+int
+filewritev(struct file *f, struct iovec *iov, int cnt, int off)
+{
+  int i, r, n, n1, tot, done, k;
+  uint o;
 
   if(f->writable == 0)
     return -1;
-  if(f->type == FD_PIPE)
-    return pipewrite(f->pipe, addr, n);
+  n = 0;
+  for(i = 0; i < cnt; i++)
+    n += iov[i].iov_len;
+  if(f->type == FD_PIPE){
+    if(off != -1)
+      return -1;
+    for(i = 0; i < cnt; i++)
+      if(pipewrite(f->pipe, iov[i].iov_base, iov[i].iov_len) < 0)
+        return -1;
+    return n;
+  }
   if(f->type == FD_INODE){
     // write a few blocks at a time to avoid exceeding
     // the maximum log transaction size, including
-    // i-node, indirect block, allocation blocks,
+    // i-node, indirect blocks, allocation blocks,
     // and 2 blocks of slop for non-aligned writes.
     // this really belongs lower down, since writei()
     // might be writing a device like the console.
-    int max = ((MAXOPBLOCKS-1-1-2) / 2) * 512;
-    int i = 0;
-    while(i < n){
-      int n1 = n - i;
+    // each op reserves only the log space its chunk
+    // can actually use (see writeblocks), and
+    // consecutive chunks share a transaction
+    // when the log has room (see end_op_defer).
+    // a chunk may gather pieces of several buffers,
+    // which it writes contiguously.
+    int max = maxwrite();
+    i = 0;
+    done = 0;  // bytes of iov[i] already written
+    r = 0;
+    for(tot = 0; tot < n; tot += k){
+      n1 = n - tot;
       if(n1 > max)
         n1 = max;
 
-      begin_op();
+      begin_op_reserve(writeblocks(n1));
       ilock(f->ip);
-      if ((r = writei(f->ip, addr + i, f->off, n1)) > 0)
-        f->off += r;
+      o = off == -1 ? f->off : off + tot;
+      for(k = 0; k < n1; k += r){
+        while(done == iov[i].iov_len){
+          i++;
+          done = 0;
+        }
+        r = iov[i].iov_len - done;
+        if(r > n1 - k)
+          r = n1 - k;
+        if((r = writei(f->ip, (char*)iov[i].iov_base + done, o + k, r)) < 0)
+          break;
+        done += r;
+      }
+      if(off == -1)
+        f->off = o + k;
       iunlock(f->ip);
-      end_op();
+      end_op_defer(f->ip);
 
       if(r < 0)
-        break;
-      if(r != n1)
+        return -1;
+      if(k != n1)
         panic("short filewrite");
-      i += r;
     }
-    return i == n ? n : -1;
+    return n;
   }
   panic("filewrite");
 }
 
+
+// Move up to n bytes from inode-backed file in into pipe
+// out, reading straight into the pipe's ring.
+static int
+splicetopipe(struct file *in, struct pipe *out, int n)
+{
+  char *dst;
+  int m, r, tot;
+
+  for(tot = 0; tot < n; tot += r){
+    if((m = pipewbegin(out, &dst, n - tot)) < 0)
+      return tot > 0 ? tot : -1;
+    ilock(in->ip);
+    if((r = readi(in->ip, dst, in->off, m)) > 0)
+      in->off += r;
+    iunlock(in->ip);
+    pipewend(out, r > 0 ? r : 0);
+    if(r < 0)
+      return tot > 0 ? tot : -1;
+    if(r == 0)
+      break;
+  }
+  return tot;
+}
+
+// Move up to n bytes from pipe in into inode-backed file
+// out, writing straight from the pipe's ring.
+static int
+splicefrompipe(struct pipe *in, struct file *out, int n)
+{
+  char *src;
+  int m, r, tot;
+
+  for(tot = 0; tot < n; tot += r){
+    m = n - tot < maxwrite() ? n - tot : maxwrite();
+    if((m = piperbegin(in, &src, m)) <= 0)
+      return tot > 0 || m == 0 ? tot : -1;
+    begin_op_reserve(writeblocks(m));
+    ilock(out->ip);
+    if((r = writei(out->ip, src, out->off, m)) > 0)
+      out->off += r;
+    iunlock(out->ip);
+    end_op_defer(out->ip);
+    // Data the file did not take stays in the pipe.
+    piperend(in, r > 0 ? r : 0);
+    if(r < 0)
+      return tot > 0 ? tot : -1;
+    if(r < m)
+      return tot + r;
+  }
+  return tot;
+}
+
+// Move up to n bytes from file in to file out inside the
+// kernel; one of them must be a pipe and the other an inode.
+// Stops early at end of file.  Returns the number of bytes
+// moved, or -1 if there was an error before any were.
+int
+filesplice(struct file *in, struct file *out, int n)
+{
+  if(in->readable == 0 || out->writable == 0 || n < 0)
+    return -1;
+  if(in->type == FD_INODE && out->type == FD_PIPE)
+    return splicetopipe(in, out->pipe, n);
+  if(in->type == FD_PIPE && out->type == FD_INODE)
+    return splicefrompipe(in->pipe, out, n);
+  return -1;
+}
+
+// Copy up to n bytes starting at offset off of file src to
+// the current offset of file dst, inside the kernel, in as
+// few transactions as the log allows.  src's offset does not
+// change.  Returns the number of bytes copied, which is less
+// than n only at the end of src, or -1 if none could be.
+int
+filecopy(struct file *src, struct file *dst, uint off, int n)
+{
+  struct inode *a, *b;
+  int m, r, tot;
+
+  if(src->readable == 0 || dst->writable == 0 || n < 0)
+    return -1;
+  if(src->type != FD_INODE || dst->type != FD_INODE || src->ip == dst->ip)
+    return -1;
+  // Only regular files may be locked as a pair: a directory
+  // and a file in it must be locked parent first, as unlink
+  // and create do, not by inode number.  The fds' references
+  // keep the types from changing.
+  if(itype(src->ip) != T_FILE || itype(dst->ip) != T_FILE)
+    return -1;
+  // Lock the two inodes in a fixed order, so that copies
+  // in opposite directions cannot deadlock.
+  a = src->ip;
+  b = dst->ip;
+  if(a->inum > b->inum){
+    a = dst->ip;
+    b = src->ip;
+  }
+  for(tot = 0; tot < n; tot += r){
+    m = n - tot < maxwrite() ? n - tot : maxwrite();
+    begin_op_reserve(writeblocks(m));
+    ilock(a);
+    ilock(b);
+    if((r = copyi(dst->ip, dst->off, src->ip, off + tot, m)) > 0)
+      dst->off += r;
+    iunlock(b);
+    iunlock(a);
+    end_op_defer(dst->ip);
+    if(r < 0)
+      return tot > 0 ? tot : -1;
+    if(r < m)
+      return tot + r;
+  }
+  return tot;
+}
+
+// Get or set a property of file f (see fcntl.h).
+int
+filefcntl(struct file *f, int cmd, int arg)
+{
+  switch(cmd){
+  case F_GETPIPE_SZ:
+    if(f->type != FD_PIPE)
+      return -1;
+    return pipegetsize(f->pipe);
+  case F_SETPIPE_SZ:
+    if(f->type != FD_PIPE)
+      return -1;
+    return pipesetsize(f->pipe, arg);
+  }
+  return -1;
+}
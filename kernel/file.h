@@ -1,6 +1,7 @@
 struct file {
   enum { FD_NONE, FD_PIPE, FD_INODE } type;
-  int ref; // reference count
+  int ref; // reference count, updated atomically
+  struct file *next; // ftable free list
   char readable;
   char writable;
   struct pipe *pipe;
@@ -14,15 +15,20 @@ struct inode {
   uint dev;           // Device number
   uint inum;          // Inode number
   int ref;            // Reference count
+  struct inode *hnext; // icache hash chain
+  struct inode *prev; // icache free list
+  struct inode *next;
   struct sleeplock lock; // protects everything below here
   int valid;          // inode has been read from disk?
+  struct dirhash *dirhash; // name index of a large directory, or 0
+  uint lastblock;     // block bmap() returned last, as balloc goal
 
   short type;         // copy of disk inode
   short major;
   short minor;
   short nlink;
   uint size;
-  uint addrs[NDIRECT+1];
+  uint addrs[NDIRECT+2];
 };
 
 // table mapping major device number to
@@ -44,7 +44,7 @@ bzero(int dev, int bno)
 {
   struct buf *bp;
 
-  bp = bread(dev, bno);
+  bp = bfresh(dev, bno);
   memset(bp->data, 0, BSIZE);
   log_write(bp);
   brelse(bp);
@@ -52,25 +52,123 @@ bzero(int dev, int bno)
 
 // Blocks.
 
-// Allocate a zeroed disk block.
+// In-memory allocation state, set up by allocinit() once the
+// log has been recovered.  nfree[g] and nifree[g] count the free
+// data blocks and inodes of group g; they are updated with the
+// group's bit map or inode block locked, so they are exact and
+// the allocators can skip full groups without reading them.
+// inext[g] is where ialloc starts looking in group g: every
+// inode before it was in use when it was set, and ifree lowers
+// it, so the in-use prefix of a group is not read again.
+#define NAGROUPS 64  // most allocation groups
+
+struct {
+  struct spinlock lock;
+  ushort nfree[NAGROUPS];
+  ushort nifree[NAGROUPS];
+  uint inext[NAGROUPS];     // inode offset in the group
+  uint bnext;               // block after the last one allocated
+} fsalloc;
+
+// Number of blocks in group g (the last may be short).
 static uint
-balloc(uint dev)
+groupsize(uint g)
 {
-  int b, bi, m;
+  return min(sb.groupsize, sb.size - GSTART(g, sb));
+}
+
+// Count the free blocks and inodes in each group of dev.
+void
+allocinit(int dev)
+{
+  int g, i, n;
+  uint inum;
   struct buf *bp;
+  struct dinode *dip;
 
-  bp = 0;
-  for(b = 0; b < sb.size; b += BPB){
-    bp = bread(dev, BBLOCK(b, sb));
-    for(bi = 0; bi < BPB && b + bi < sb.size; bi++){
-      m = 1 << (bi % 8);
-      if((bp->data[bi/8] & m) == 0){  // Is block free?
-        bp->data[bi/8] |= m;  // Mark block in use.
-        log_write(bp);
-        brelse(bp);
-        bzero(dev, b + bi);
-        return b + bi;
-      }
+  initlock(&fsalloc.lock, "fsalloc");
+  if(sb.ngroups > NAGROUPS)
+    panic("allocinit: too many groups");
+  for(g = 0; g < sb.ngroups; g++){
+    bp = bread(dev, GSTART(g, sb));
+    n = 0;
+    for(i = 0; i < groupsize(g); i++)
+      if((bp->data[i/8] & (1 << (i % 8))) == 0)
+        n++;
+    brelse(bp);
+    fsalloc.nfree[g] = n;
+
+    n = 0;
+    for(inum = g * sb.ipg; inum < (g + 1) * sb.ipg; inum += IPB){
+      bp = bread(dev, IBLOCK(inum, sb));
+      for(dip = (struct dinode*)bp->data; dip < (struct dinode*)bp->data + IPB; dip++)
+        if(dip->type == 0)
+          n++;
+      brelse(bp);
+    }
+    if(g == 0)
+      n--;  // inum 0 is never used
+    fsalloc.nifree[g] = n;
+  }
+  fsalloc.bnext = GDATA(0, sb);
+}
+
+// Return the first clear bit at or after bit start of the
+// nbits-bit map, wrapping around, or -1 if all are set.
+static int
+bitfind(uchar *map, int start, int nbits)
+{
+  int k, bi;
+
+  for(k = 0; k < nbits; k++){
+    bi = (start + k) % nbits;
+    if(bi % 8 == 0 && bi + 8 <= nbits && map[bi/8] == 0xff){
+      k += 7;  // whole byte in use
+      continue;
+    }
+    if((map[bi/8] & (1 << (bi % 8))) == 0)
+      return bi;
+  }
+  return -1;
+}
+
+// Allocate a disk block, as close after goal as possible:
+// in goal's group if it has room, else in the following
+// groups.  goal 0 means anywhere.  The block is zeroed
+// unless zero is 0, in which case the caller must overwrite
+// all of it in the same transaction.
+static uint
+balloc(uint dev, uint goal, int zero)
+{
+  int i, n, bi;
+  uint g;
+  struct buf *bp;
+
+  acquire(&fsalloc.lock);
+  if(goal < sb.groupstart || goal >= sb.size)
+    goal = fsalloc.bnext;
+  release(&fsalloc.lock);
+
+  for(i = 0; i < sb.ngroups; i++){
+    g = (BGROUP(goal, sb) + i) % sb.ngroups;
+    acquire(&fsalloc.lock);
+    n = fsalloc.nfree[g];
+    release(&fsalloc.lock);
+    if(n == 0)
+      continue;
+    bp = bread(dev, GSTART(g, sb));
+    bi = bitfind(bp->data, i == 0 ? BBIT(goal, sb) : 0, groupsize(g));
+    if(bi >= 0){
+      bp->data[bi/8] |= 1 << (bi % 8);  // Mark block in use.
+      log_write(bp);
+      acquire(&fsalloc.lock);
+      fsalloc.nfree[g]--;
+      fsalloc.bnext = GSTART(g, sb) + bi + 1;
+      release(&fsalloc.lock);
+      brelse(bp);
+      if(zero)
+        bzero(dev, GSTART(g, sb) + bi);
+      return GSTART(g, sb) + bi;
     }
     brelse(bp);
   }
@@ -85,12 +183,15 @@ bfree(int dev, uint b)
   int bi, m;
 
   bp = bread(dev, BBLOCK(b, sb));
-  bi = b % BPB;
+  bi = BBIT(b, sb);
   m = 1 << (bi % 8);
   if((bp->data[bi/8] & m) == 0)
     panic("freeing free block");
   bp->data[bi/8] &= ~m;
   log_write(bp);
+  acquire(&fsalloc.lock);
+  fsalloc.nfree[BGROUP(b, sb)]++;
+  release(&fsalloc.lock);
   brelse(bp);
 }
 
@@ -101,9 +202,9 @@ bfree(int dev, uint b)
 // its size, the number of links referring to it, and the
 // list of blocks holding the file's content.
 //
-// The inodes are laid out sequentially on disk at
-// sb.startinode. Each inode has a number, indicating its
-// position on the disk.
+// The inodes are laid out on disk in slices of sb.ipg, one
+// at the start of each allocation group. Each inode has a
+// number, indicating its position on the disk.
 //
 // The kernel keeps a cache of in-use inodes in memory
 // to provide a place for synchronizing access
@@ -124,13 +225,17 @@ bfree(int dev, uint b)
 //   the number of in-memory pointers to the entry (open
 //   files and current directories). iget() finds or
 //   creates a cache entry and increments its ref; iput()
-//   decrements ref.
+//   decrements ref. A free entry keeps its identity and
+//   contents until iget() recycles it for another inode,
+//   least recently released first, so reopening a recently
+//   closed file finds it still cached.
 //
 // * Valid: the information (type, size, &c) in an inode
 //   cache entry is only correct when ip->valid is 1.
 //   ilock() reads the inode from
-//   the disk and sets ip->valid, while iput() clears
-//   ip->valid if ip->ref has fallen to zero.
+//   the disk and sets ip->valid, while iget() clears
+//   ip->valid when it recycles the entry and iput() clears
+//   it when it frees the inode on disk.
 //
 // * Locked: file system code may only examine and modify
 //   the information in an inode and its content if it
@@ -157,62 +262,172 @@ bfree(int dev, uint b)
 // The icache.lock spin-lock protects the allocation of icache
 // entries. Since ip->ref indicates whether an entry is free,
 // and ip->dev and ip->inum indicate which i-node an entry
-// holds, one must hold icache.lock while using any of those fields.
+// holds, one must hold icache.lock while using any of those fields,
+// or the hash and free-list links.
 //
 // An ip->lock sleep-lock protects all ip-> fields other than ref,
 // dev, and inum.  One must hold ip->lock in order to
 // read or write that inode's ip->valid, ip->size, ip->type, &c.
 
+#define NIHASH 61
+
 struct {
   struct spinlock lock;
   struct inode inode[NINODE];
+
+  // Entries holding an inode, chained through hnext by
+  // (dev, inum). Entries that have never held one have inum 0.
+  struct inode *hash[NIHASH];
+
+  // Linked list of free (ref == 0) entries, through prev/next.
+  // head.next is most recently released; iget recycles head.prev.
+  struct inode head;
 } icache;
 
+static struct inode**
+ibucket(uint dev, uint inum)
+{
+  return &icache.hash[(dev*31 + inum) % NIHASH];
+}
+
+// Remove ip from the free list.
+static void
+ifreeremove(struct inode *ip)
+{
+  ip->next->prev = ip->prev;
+  ip->prev->next = ip->next;
+}
+
+// Add ip to the free list, at the front if its contents
+// are worth keeping, otherwise at the back.
+static void
+ifreeinsert(struct inode *ip)
+{
+  struct inode *after;
+
+  after = ip->valid ? &icache.head : icache.head.prev;
+  ip->next = after->next;
+  ip->prev = after;
+  after->next->prev = ip;
+  after->next = ip;
+}
+
 void
 iinit(int dev)
 {
   int i = 0;
   
   initlock(&icache.lock, "icache");
+  icache.head.prev = &icache.head;
+  icache.head.next = &icache.head;
   for(i = 0; i < NINODE; i++) {
     initsleeplock(&icache.inode[i].lock, "inode");
+    ifreeinsert(&icache.inode[i]);
   }
 
   readsb(dev, &sb);
   cprintf("sb: size %d nblocks %d ninodes %d nlog %d logstart %d\
- inodestart %d bmap start %d\n", sb.size, sb.nblocks,
-          sb.ninodes, sb.nlog, sb.logstart, sb.inodestart,
-          sb.bmapstart);
+ ngroups %d groupstart %d groupsize %d\n", sb.size, sb.nblocks,
+          sb.ninodes, sb.nlog, sb.logstart, sb.ngroups,
+          sb.groupstart, sb.groupsize);
 }
 
-static struct inode* iget(uint dev, uint inum);
-
 //PAGEBREAK!
-// Allocate an inode on device dev.
+// Choose the group for a new inode of the given type in
+// directory parent.  Files go in their directory's group,
+// so that a directory's files stay near each other; new
+// directories go to the group with the most free blocks,
+// spreading them, and their files, over the disk.
+static uint
+igroup(short type, uint parent)
+{
+  uint g, best;
+
+  if(type != T_DIR)
+    return IGROUP(parent, sb);
+  best = IGROUP(parent, sb);
+  acquire(&fsalloc.lock);
+  for(g = 0; g < sb.ngroups; g++)
+    if(fsalloc.nifree[g] > 0 && fsalloc.nfree[g] > fsalloc.nfree[best])
+      best = g;
+  release(&fsalloc.lock);
+  return best;
+}
+
+// Allocate an inode on device dev, to be linked into the
+// directory with inode number parent.
 // Mark it as allocated by  giving it type type.
 // Returns an unlocked but allocated and referenced inode.
 struct inode*
-ialloc(uint dev, short type)
+ialloc(uint dev, short type, uint parent)
 {
-  int inum;
+  int i, n;
+  uint g, inum, start, k;
   struct buf *bp;
   struct dinode *dip;
 
-  for(inum = 1; inum < sb.ninodes; inum++){
-    bp = bread(dev, IBLOCK(inum, sb));
-    dip = (struct dinode*)bp->data + inum%IPB;
-    if(dip->type == 0){  // a free inode
-      memset(dip, 0, sizeof(*dip));
-      dip->type = type;
-      log_write(bp);   // mark it allocated on the disk
-      brelse(bp);
-      return iget(dev, inum);
+  g = igroup(type, parent);
+  for(i = 0; i < sb.ngroups; i++, g = (g + 1) % sb.ngroups){
+    acquire(&fsalloc.lock);
+    n = fsalloc.nifree[g];
+    start = fsalloc.inext[g];
+    release(&fsalloc.lock);
+    if(n == 0)
+      continue;
+    bp = 0;
+    // Resume at the group's cursor, wrapping around in case
+    // a racing ifree was missed.
+    for(k = 0; k < sb.ipg; k++){
+      inum = g * sb.ipg + (start + k) % sb.ipg;
+      if(inum == 0)
+        continue;
+      if(bp == 0 || bp->blockno != IBLOCK(inum, sb)){
+        if(bp)
+          brelse(bp);
+        bp = bread(dev, IBLOCK(inum, sb));
+      }
+      dip = (struct dinode*)bp->data + inum%IPB;
+      if(dip->type == 0){  // a free inode
+        memset(dip, 0, sizeof(*dip));
+        dip->type = type;
+        log_write(bp);   // mark it allocated on the disk
+        acquire(&fsalloc.lock);
+        fsalloc.nifree[g]--;
+        // Advance only if no ifree or ialloc moved it meanwhile.
+        if(fsalloc.inext[g] == start)
+          fsalloc.inext[g] = inum % sb.ipg + 1;
+        release(&fsalloc.lock);
+        brelse(bp);
+        return iget(dev, inum);
+      }
     }
-    brelse(bp);
+    if(bp)
+      brelse(bp);
   }
   panic("ialloc: no inodes");
 }
 
+// Mark ip free on disk.  The rest of the dinode must
+// already have been cleared.  Caller must hold ip->lock.
+static void
+ifree(struct inode *ip)
+{
+  struct buf *bp;
+  struct dinode *dip;
+
+  ip->type = 0;
+  bp = bread(ip->dev, IBLOCK(ip->inum, sb));
+  dip = (struct dinode*)bp->data + ip->inum%IPB;
+  dip->type = 0;
+  log_write(bp);
+  acquire(&fsalloc.lock);
+  fsalloc.nifree[IGROUP(ip->inum, sb)]++;
+  if(ip->inum % sb.ipg < fsalloc.inext[IGROUP(ip->inum, sb)])
+    fsalloc.inext[IGROUP(ip->inum, sb)] = ip->inum % sb.ipg;
+  release(&fsalloc.lock);
+  brelse(bp);
+}
+
 // Copy a modified in-memory inode to disk.
 // Must be called after every change to an ip->xxx field
 // that lives on disk, since i-node cache is write-through.
@@ -238,34 +453,41 @@ iupdate(struct inode *ip)
 // Find the inode with number inum on device dev
 // and return the in-memory copy. Does not lock
 // the inode and does not read it from disk.
-static struct inode*
+struct inode*
 iget(uint dev, uint inum)
 {
-  struct inode *ip, *empty;
+  struct inode *ip, **pp;
 
   acquire(&icache.lock);
 
   // Is the inode already cached?
-  empty = 0;
-  for(ip = &icache.inode[0]; ip < &icache.inode[NINODE]; ip++){
-    if(ip->ref > 0 && ip->dev == dev && ip->inum == inum){
-      ip->ref++;
+  for(ip = *ibucket(dev, inum); ip; ip = ip->hnext){
+    if(ip->dev == dev && ip->inum == inum){
+      if(ip->ref++ == 0)
+        ifreeremove(ip);
       release(&icache.lock);
       return ip;
     }
-    if(empty == 0 && ip->ref == 0)    // Remember empty slot.
-      empty = ip;
   }
 
-  // Recycle an inode cache entry.
-  if(empty == 0)
+  // Recycle the least recently released cache entry.
+  ip = icache.head.prev;
+  if(ip == &icache.head)
     panic("iget: no inodes");
-
-  ip = empty;
+  ifreeremove(ip);
+  if(ip->inum != 0){
+    for(pp = ibucket(ip->dev, ip->inum); *pp != ip; pp = &(*pp)->hnext)
+      ;
+    *pp = ip->hnext;
+  }
+  dirhash_free(ip);
   ip->dev = dev;
   ip->inum = inum;
   ip->ref = 1;
   ip->valid = 0;
+  pp = ibucket(dev, inum);
+  ip->hnext = *pp;
+  *pp = ip;
   release(&icache.lock);
 
   return ip;
@@ -305,6 +527,7 @@ ilock(struct inode *ip)
     ip->size = dip->size;
     memmove(ip->addrs, dip->addrs, sizeof(ip->addrs));
     brelse(bp);
+    ip->lastblock = 0;
     ip->valid = 1;
     if(ip->type == 0)
       panic("ilock: no type");
@@ -338,16 +561,18 @@ iput(struct inode *ip)
     release(&icache.lock);
     if(r == 1){
       // inode has no links and no other references: truncate and free.
+      dirhash_free(ip);
+      dcache_purge(ip->dev, ip->inum);
       itrunc(ip);
-      ip->type = 0;
-      iupdate(ip);
+      ifree(ip);
       ip->valid = 0;
     }
   }
   releasesleep(&ip->lock);
 
   acquire(&icache.lock);
-  ip->ref--;
+  if(--ip->ref == 0)
+    ifreeinsert(ip);
   release(&icache.lock);
 }
 
@@ -365,40 +590,99 @@ iunlockput(struct inode *ip)
 // The content (data) associated with each inode is stored
 // in blocks on the disk. The first NDIRECT block numbers
 // are listed in ip->addrs[].  The next NINDIRECT blocks are
-// listed in block ip->addrs[NDIRECT].
+// listed in block ip->addrs[NDIRECT]. The NDINDIRECT blocks
+// after that are listed in the indirect blocks whose numbers
+// are in turn listed in block ip->addrs[NDIRECT+1].
 
-// Return the disk block address of the nth block in inode ip.
-// If there is no such block, bmap allocates one.
+// Allocate a block for ip's content, preferably just
+// after the block it last mapped, to keep files contiguous,
+// and otherwise in ip's own group.
 static uint
-bmap(struct inode *ip, uint bn)
+iballoc(struct inode *ip, int zero)
 {
-  uint addr, *a;
+  if(ip->lastblock)
+    return balloc(ip->dev, ip->lastblock + 1, zero);
+  return balloc(ip->dev, GDATA(IGROUP(ip->inum, sb), sb), zero);
+}
+
+// Return entry bn of the indirect block at addr.
+// If the entry is empty, allocate a block for it,
+// zeroed if zero is set.
+static uint
+bindirect(struct inode *ip, uint addr, uint bn, int zero)
+{
+  uint *a;
   struct buf *bp;
 
+  bp = bread(ip->dev, addr);
+  a = (uint*)bp->data;
+  if((addr = a[bn]) == 0){
+    a[bn] = addr = iballoc(ip, zero);
+    log_write(bp);
+  }
+  brelse(bp);
+  return addr;
+}
+
+// Return the disk block address of the nth block in inode ip.
+// If there is no such block, bmap allocates one.  If full is
+// set, the caller is about to overwrite the whole block, so a
+// newly allocated one is not zeroed first.
+static uint
+bmap(struct inode *ip, uint bn, int full)
+{
+  uint addr;
+
   if(bn < NDIRECT){
     if((addr = ip->addrs[bn]) == 0)
-      ip->addrs[bn] = addr = balloc(ip->dev);
-    return addr;
+      ip->addrs[bn] = addr = iballoc(ip, !full);
+    return ip->lastblock = addr;
   }
   bn -= NDIRECT;
 
   if(bn < NINDIRECT){
     // Load indirect block, allocating if necessary.
     if((addr = ip->addrs[NDIRECT]) == 0)
-      ip->addrs[NDIRECT] = addr = balloc(ip->dev);
-    bp = bread(ip->dev, addr);
-    a = (uint*)bp->data;
-    if((addr = a[bn]) == 0){
-      a[bn] = addr = balloc(ip->dev);
-      log_write(bp);
-    }
-    brelse(bp);
-    return addr;
+      ip->addrs[NDIRECT] = addr = iballoc(ip, 1);
+    return ip->lastblock = bindirect(ip, addr, bn, !full);
+  }
+  bn -= NINDIRECT;
+
+  if(bn < NDINDIRECT){
+    // Load doubly-indirect block, then the indirect
+    // block it names, allocating if necessary.
+    if((addr = ip->addrs[NDIRECT+1]) == 0)
+      ip->addrs[NDIRECT+1] = addr = iballoc(ip, 1);
+    addr = bindirect(ip, addr, bn / NINDIRECT, 1);
+    return ip->lastblock = bindirect(ip, addr, bn % NINDIRECT, !full);
   }
 
   panic("bmap: out of range");
 }
 
+// Free the indirect block at addr and the blocks it lists.
+// If depth > 1, the listed blocks are themselves indirect.
+static void
+bfreeindirect(struct inode *ip, uint addr, int depth)
+{
+  int j;
+  struct buf *bp;
+  uint *a;
+
+  bp = bread(ip->dev, addr);
+  a = (uint*)bp->data;
+  for(j = 0; j < NINDIRECT; j++){
+    if(a[j] == 0)
+      continue;
+    if(depth > 1)
+      bfreeindirect(ip, a[j], depth - 1);
+    else
+      bfree(ip->dev, a[j]);
+  }
+  brelse(bp);
+  bfree(ip->dev, addr);
+}
+
 // Truncate inode (discard contents).
 // Only called when the inode has no links
 // to it (no directory entries referring to it)
@@ -407,9 +691,7 @@ bmap(struct inode *ip, uint bn)
 static void
 itrunc(struct inode *ip)
 {
-  int i, j;
-  struct buf *bp;
-  uint *a;
+  int i;
 
   for(i = 0; i < NDIRECT; i++){
     if(ip->addrs[i]){
@@ -419,17 +701,15 @@ itrunc(struct inode *ip)
   }
 
   if(ip->addrs[NDIRECT]){
-    bp = bread(ip->dev, ip->addrs[NDIRECT]);
-    a = (uint*)bp->data;
-    for(j = 0; j < NINDIRECT; j++){
-      if(a[j])
-        bfree(ip->dev, a[j]);
-    }
-    brelse(bp);
-    bfree(ip->dev, ip->addrs[NDIRECT]);
+    bfreeindirect(ip, ip->addrs[NDIRECT], 1);
     ip->addrs[NDIRECT] = 0;
   }
 
+  if(ip->addrs[NDIRECT+1]){
+    bfreeindirect(ip, ip->addrs[NDIRECT+1], 2);
+    ip->addrs[NDIRECT+1] = 0;
+  }
+
   ip->size = 0;
   iupdate(ip);
 }
@@ -467,7 +747,7 @@ readi(struct inode *ip, char *dst, uint off, uint n)
     n = ip->size - off;
 
   for(tot=0; tot<n; tot+=m, off+=m, dst+=m){
-    bp = bread(ip->dev, bmap(ip, off/BSIZE));
+    bp = bread(ip->dev, bmap(ip, off/BSIZE, 0));
     m = min(n - tot, BSIZE - off%BSIZE);
     memmove(dst, bp->data + off%BSIZE, m);
     brelse(bp);
@@ -492,12 +772,17 @@ writei(struct inode *ip, char *src, uint off, uint n)
 
   if(off > ip->size || off + n < off)
     return -1;
-  if(off + n > MAXFILE*BSIZE)
+  if(n > 0 && (off + n - 1) / BSIZE >= MAXFILE)
     return -1;
 
   for(tot=0; tot<n; tot+=m, off+=m, src+=m){
-    bp = bread(ip->dev, bmap(ip, off/BSIZE));
     m = min(n - tot, BSIZE - off%BSIZE);
+    // A whole-block write needs neither the old contents
+    // nor, for a new block, zeroes.
+    if(m == BSIZE)
+      bp = bfresh(ip->dev, bmap(ip, off/BSIZE, 1));
+    else
+      bp = bread(ip->dev, bmap(ip, off/BSIZE, 0));
     memmove(bp->data + off%BSIZE, src, m);
     log_write(bp);
     brelse(bp);
@@ -510,6 +795,50 @@ writei(struct inode *ip, char *src, uint off, uint n)
   return n;
 }
 
+// Return ip's type, locking it just long enough to read it.
+short
+itype(struct inode *ip)
+{
+  short type;
+
+  ilock(ip);
+  type = ip->type;
+  iunlock(ip);
+  return type;
+}
+
+// Copy n bytes at soff in src to doff in dst, writing each
+// source block's contents straight from the buffer cache.
+// Stops at the end of src.  Both must be regular files and
+// distinct (writing dst while holding a buffer of src could
+// otherwise deadlock on a shared block).  Caller must hold
+// both locks and be in a transaction big enough to write n
+// bytes to dst.  Returns the number of bytes copied, or -1.
+int
+copyi(struct inode *dst, uint doff, struct inode *src, uint soff, uint n)
+{
+  uint tot, m;
+  struct buf *bp;
+  int r;
+
+  if(dst == src || dst->type != T_FILE || src->type != T_FILE)
+    return -1;
+  if(soff > src->size || soff + n < soff)
+    return -1;
+  if(soff + n > src->size)
+    n = src->size - soff;
+
+  for(tot=0; tot<n; tot+=m, soff+=m, doff+=m){
+    bp = bread(src->dev, bmap(src, soff/BSIZE, 0));
+    m = min(n - tot, BSIZE - soff%BSIZE);
+    r = writei(dst, (char*)bp->data + soff%BSIZE, doff, m);
+    brelse(bp);
+    if(r != m)
+      return tot > 0 ? tot : -1;
+  }
+  return n;
+}
+
 //PAGEBREAK!
 // Directories
 
@@ -521,6 +850,8 @@ namecmp(const char *s, const char *t)
 
 // Look for a directory entry in a directory.
 // If found, set *poff to byte offset of entry.
+// Large directories are searched through their dirhash index.
+// The result, found or not, is entered in the dcache.
 struct inode*
 dirlookup(struct inode *dp, char *name, uint *poff)
 {
@@ -530,6 +861,17 @@ dirlookup(struct inode *dp, char *name, uint *poff)
   if(dp->type != T_DIR)
     panic("dirlookup not DIR");
 
+  switch(dirhash_lookup(dp, name, &off, &inum)){
+  case 0:
+    dcache_enter(dp, name, 0);
+    return 0;
+  case 1:
+    if(poff)
+      *poff = off;
+    dcache_enter(dp, name, inum);
+    return iget(dp->dev, inum);
+  }
+
   for(off = 0; off < dp->size; off += sizeof(de)){
     if(readi(dp, (char*)&de, off, sizeof(de)) != sizeof(de))
       panic("dirlookup read");
@@ -540,10 +882,12 @@ dirlookup(struct inode *dp, char *name, uint *poff)
       if(poff)
         *poff = off;
       inum = de.inum;
+      dcache_enter(dp, name, inum);
       return iget(dp->dev, inum);
     }
   }
 
+  dcache_enter(dp, name, 0);
   return 0;
 }
 
@@ -562,7 +906,7 @@ dirlink(struct inode *dp, char *name, uint inum)
   }
 
   // Look for an empty dirent.
-  for(off = 0; off < dp->size; off += sizeof(de)){
+  for(off = dirhash_freeoff(dp); off < dp->size; off += sizeof(de)){
     if(readi(dp, (char*)&de, off, sizeof(de)) != sizeof(de))
       panic("dirlink read");
     if(de.inum == 0)
@@ -573,10 +917,25 @@ dirlink(struct inode *dp, char *name, uint inum)
   de.inum = inum;
   if(writei(dp, (char*)&de, off, sizeof(de)) != sizeof(de))
     panic("dirlink");
+  dirhash_add(dp, name, off);
+  dcache_enter(dp, name, inum);
 
   return 0;
 }
 
+// Clear the directory entry for name at byte offset off in dp.
+void
+dirunlink(struct inode *dp, char *name, uint off)
+{
+  struct dirent de;
+
+  memset(&de, 0, sizeof(de));
+  if(writei(dp, (char*)&de, off, sizeof(de)) != sizeof(de))
+    panic("dirunlink");
+  dirhash_remove(dp, name, off);
+  dcache_enter(dp, name, 0);
+}
+
 //PAGEBREAK!
 // Paths
 
@@ -621,6 +980,9 @@ skipelem(char *path, char *name)
 // If parent != 0, return the inode for the parent and copy the final
 // path element into name, which must have room for DIRSIZ bytes.
 // Must be called inside a transaction since it calls iput().
+// Components found in the dcache are crossed without locking
+// the directory: it was one when the entry was made, and its
+// entries are purged if it is freed.
 static struct inode*
 namex(char *path, int nameiparent, char *name)
 {
@@ -632,6 +994,13 @@ namex(char *path, int nameiparent, char *name)
     ip = idup(myproc()->cwd);
 
   while((path = skipelem(path, name)) != 0){
+    if(!(nameiparent && *path == '\0') && dcache_lookup(ip, name, &next)){
+      iput(ip);
+      if(next == 0)
+        return 0;
+      ip = next;
+      continue;
+    }
     ilock(ip);
     if(ip->type != T_DIR){
       iunlockput(ip);
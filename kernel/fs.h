@@ -3,11 +3,23 @@
 
 
 #define ROOTINO 1  // root i-number
+
+// Block size in bytes: one disk sector by default; the Makefile
+// can select 4096 instead.  The kernel, mkfs and user programs
+// must all be built with the same value.
+#ifndef BSIZE
 #define BSIZE 512  // block size
+#endif
 
 // Disk layout:
-// [ boot block | super block | log | inode blocks |
-//                                          free bit map | data blocks]
+// [ boot block | super block | log | group 0 | group 1 | ... ]
+//
+// The blocks after the log are divided into allocation groups of
+// groupsize blocks (the last may be shorter).  Each group is laid
+// out as
+// [ free bit map block | ipg inodes | data blocks ]
+// and the bit map covers just the group's own blocks, so a file
+// whose inode and data share a group stays in one small region.
 //
 // mkfs computes the super block and builds an initial file system. The
 // super block describes the disk layout:
@@ -17,13 +29,22 @@ struct superblock {
   uint ninodes;      // Number of inodes.
   uint nlog;         // Number of log blocks
   uint logstart;     // Block number of first log block
-  uint inodestart;   // Block number of first inode block
-  uint bmapstart;    // Block number of first free map block
+  uint ngroups;      // Number of allocation groups
+  uint groupstart;   // Block number of first group
+  uint groupsize;    // Blocks per group, at most BPB
+  uint ipg;          // Inodes per group, a multiple of IPB
 };
 
-#define NDIRECT 12
+// The log header block holds a count and the home block number
+// of each logged block, which bounds the usable log size.
+#define MAXLOGBLOCKS (BSIZE / sizeof(uint) - 1)
+
+// A file's blocks are named by NDIRECT direct block numbers,
+// one singly-indirect block and one doubly-indirect block.
+#define NDIRECT 11
 #define NINDIRECT (BSIZE / sizeof(uint))
-#define MAXFILE (NDIRECT + NINDIRECT)
+#define NDINDIRECT (NINDIRECT * NINDIRECT)
+#define MAXFILE (NDIRECT + NINDIRECT + NDINDIRECT)
 
 // On-disk inode structure
 struct dinode {
@@ -32,20 +53,31 @@ struct dinode {
   short minor;          // Minor device number (T_DEV only)
   short nlink;          // Number of links to inode in file system
   uint size;            // Size of file (bytes)
-  uint addrs[NDIRECT+1];   // Data block addresses
+  uint addrs[NDIRECT+2];   // Data block addresses
 };
 
 // Inodes per block.
 #define IPB           (BSIZE / sizeof(struct dinode))
 
-// Block containing inode i
-#define IBLOCK(i, sb)     ((i) / IPB + sb.inodestart)
-
 // Bitmap bits per block
 #define BPB           (BSIZE*8)
 
-// Block of free map containing bit for block b
-#define BBLOCK(b, sb) (b/BPB + sb.bmapstart)
+// First block (the free map block) of group g
+#define GSTART(g, sb)     ((sb).groupstart + (g) * (sb).groupsize)
+
+// First data block of group g
+#define GDATA(g, sb)      (GSTART(g, sb) + 1 + (sb).ipg / IPB)
+
+// Group holding inode i, and the group holding block b
+#define IGROUP(i, sb)     ((i) / (sb).ipg)
+#define BGROUP(b, sb)     (((b) - (sb).groupstart) / (sb).groupsize)
+
+// Block containing inode i
+#define IBLOCK(i, sb)     (GSTART(IGROUP(i, sb), sb) + 1 + (i) % (sb).ipg / IPB)
+
+// Block of free map containing bit for block b, and that bit
+#define BBLOCK(b, sb)     GSTART(BGROUP(b, sb), sb)
+#define BBIT(b, sb)       (((b) - (sb).groupstart) % (sb).groupsize)
 
 // Directory is a file containing a sequence of dirent structures.
 #define DIRSIZ 14
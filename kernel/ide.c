@@ -23,6 +23,10 @@
 #define IDE_CMD_WRITE 0x30
 #define IDE_CMD_RDMUL 0xc4
 #define IDE_CMD_WRMUL 0xc5
+#define IDE_CMD_SETMUL 0xc6
+
+#define SECTOR_PER_BLOCK (BSIZE/SECTOR_SIZE)
+#define IDE_MAXMULT   16  // most sectors per multiple-sector command
 
 // idequeue points to the buf now being read/written to the disk.
 // idequeue->qnext points to the next buf to be processed.
@@ -65,6 +69,19 @@ ideinit(void)
     }
   }
 
+  // Blocks larger than a sector are transferred with the
+  // multiple-sector commands, which move a whole block per
+  // interrupt once each disk's multiple count is set to it.
+  if(SECTOR_PER_BLOCK > 1){
+    for(i = 0; i <= havedisk1; i++){
+      outb(0x1f6, 0xe0 | (i<<4));
+      outb(0x1f2, SECTOR_PER_BLOCK);
+      outb(0x1f7, IDE_CMD_SETMUL);
+      if(idewait(1) < 0)
+        panic("ideinit: set multiple");
+    }
+  }
+
   // Switch back to disk 0.
   outb(0x1f6, 0xe0 | (0<<4));
 }
@@ -77,12 +94,12 @@ idestart(struct buf *b)
     panic("idestart");
   if(b->blockno >= FSSIZE)
     panic("incorrect blockno");
-  int sector_per_block =  BSIZE/SECTOR_SIZE;
+  int sector_per_block =  SECTOR_PER_BLOCK;
   int sector = b->blockno * sector_per_block;
   int read_cmd = (sector_per_block == 1) ? IDE_CMD_READ :  IDE_CMD_RDMUL;
   int write_cmd = (sector_per_block == 1) ? IDE_CMD_WRITE : IDE_CMD_WRMUL;
 
-  if (sector_per_block > 7) panic("idestart");
+  if (sector_per_block > IDE_MAXMULT) panic("idestart");
 
   idewait(0);
   outb(0x3f6, 0);  // generate interrupt
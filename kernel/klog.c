@@ -0,0 +1,189 @@
+// Kernel log.
+//
+// cprintf() takes cons.lock and writes every character to the
+// CGA and UART, too slow for hot paths like the scheduler.
+// klog() instead formats into a record in its own CPU's ring,
+// with interrupts off and no lock: each ring has one writer.
+// A shared counter, bumped atomically as a record completes,
+// orders records across CPUs.  The record's seq is 0 while it
+// is being written, so klogread() copies a record and keeps
+// the copy only if its seq was the same before and after.
+// Old records are overwritten when a ring wraps.  A CPU's
+// writing flag covers the moment between taking a number and
+// storing it, so readers do not skip past a number that has
+// been handed out but is not visible yet.
+//
+// With KLOG_CONSOLE on, CPU 0's timer interrupt copies a few
+// new records per tick to the console, so logging never waits
+// for the UART.
+
+#include "types.h"
+#include "defs.h"
+#include "param.h"
+#include "memlayout.h"
+#include "mmu.h"
+#include "proc.h"
+#include "x86.h"
+#include "klog.h"
+
+#define KLOGFLUSH 4   // records copied to the console per tick
+
+struct klogbuf {
+  uint w;                 // records written
+  int writing;            // between taking a seq and storing it
+  struct klogrec rec[NKLOG];
+};
+
+static struct klogbuf klogbuf[NCPU];
+static uint seq;          // last sequence number handed out
+static uint cleared;      // klogread skips records up to here
+static uint printed;      // console has records up to here
+static int toconsole;
+
+static void
+klogputc(int c, void *arg)
+{
+  struct klogrec *r;
+
+  r = arg;
+  if(r->len < KLOGTEXT-1)
+    r->text[r->len++] = c;
+}
+
+// Log a message.  Understands the same formats as cprintf().
+// Safe in any context, including with locks held.
+void
+klog(char *fmt, ...)
+{
+  struct klogbuf *kb;
+  struct klogrec *r;
+
+  pushcli();
+  kb = &klogbuf[cpuid()];
+  r = &kb->rec[kb->w++ % NKLOG];
+  r->seq = 0;
+  __sync_synchronize();
+  r->ticks = ticks;
+  r->cpu = cpuid();
+  r->len = 0;
+  vprintfmt(klogputc, r, fmt, (uint*)(void*)(&fmt + 1));
+  r->text[r->len] = 0;
+  kb->writing = 1;
+  __sync_synchronize();
+  r->seq = __sync_add_and_fetch(&seq, 1);
+  __sync_synchronize();
+  kb->writing = 0;
+  popcli();
+}
+
+// Is some CPU between taking a sequence number and storing
+// it in its record?
+static int
+writing(void)
+{
+  struct klogbuf *kb;
+
+  __sync_synchronize();
+  for(kb = klogbuf; kb < &klogbuf[ncpu]; kb++)
+    if(kb->writing)
+      return 1;
+  return 0;
+}
+
+// Copy into *out the oldest record still in the rings with a
+// sequence number after last.  Returns 0 if there is none, or
+// if record last+1 may still be about to appear.
+static int
+next(uint last, struct klogrec *out)
+{
+  struct klogbuf *kb;
+  struct klogrec *r, *best;
+  uint s;
+  int rescanned;
+
+  rescanned = 0;
+  for(;;){
+    best = 0;
+    for(kb = klogbuf; kb < &klogbuf[ncpu]; kb++){
+      for(r = kb->rec; r < &kb->rec[NKLOG]; r++){
+        s = r->seq;
+        if(s > last && (best == 0 || s < best->seq))
+          best = r;
+      }
+    }
+    if(best == 0)
+      return 0;
+    s = best->seq;
+    if(s > last + 1){
+      // A gap: record last+1 was overwritten, or its writer
+      // has its number but has not stored it yet.  Wait for
+      // any such writer; once none is left, every number
+      // handed out before s is visible, so scan once more
+      // and accept a gap that remains as lost records.
+      if(writing())
+        return 0;
+      if(!rescanned){
+        rescanned = 1;
+        continue;
+      }
+    }
+    __sync_synchronize();
+    *out = *best;
+    __sync_synchronize();
+    // Keep the copy only if no writer reused the record.
+    if(s != 0 && best->seq == s && out->seq == s)
+      return 1;
+  }
+}
+
+// Move up to n records logged after record number last into r.
+// Returns the number moved.
+int
+klogread(uint last, struct klogrec *r, int n)
+{
+  int k;
+
+  if(last < cleared)
+    last = cleared;
+  for(k = 0; k < n && next(last, &r[k]); k++)
+    last = r[k].seq;
+  return k;
+}
+
+int
+klogctl(int cmd, uint arg)
+{
+  switch(cmd){
+  case KLOG_QUIET:
+    toconsole = 0;
+    return 0;
+  case KLOG_CONSOLE:
+    printed = seq;
+    toconsole = 1;
+    return 0;
+  case KLOG_CLEAR:
+    // Only what the caller has seen: arg is a record's seq.
+    if(arg > seq)
+      arg = seq;
+    if(arg > cleared)
+      cleared = arg;
+    return 0;
+  }
+  return -1;
+}
+
+// Copy a few new records to the console.
+// Called by CPU 0's timer interrupt.
+void
+klogflush(void)
+{
+  struct klogrec r;
+  int i;
+
+  if(!toconsole)
+    return;
+  for(i = 0; i < KLOGFLUSH && next(printed, &r); i++){
+    cprintf("[%d] cpu%d: %s\n", r.ticks, r.cpu, r.text);
+    printed = r.seq;
+  }
+}
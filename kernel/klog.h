@@ -0,0 +1,18 @@
+// Kernel log: klog() appends a formatted message to its CPU's
+// ring, and klogread() returns messages from all CPUs in order.
+
+// klogctl() commands
+#define KLOG_QUIET    0   // stop copying messages to the console
+#define KLOG_CONSOLE  1   // copy new messages to the console
+#define KLOG_CLEAR    2   // hide messages up to arg from klogread
+
+#define NKLOG 64          // records kept per CPU
+#define KLOGTEXT 116
+
+struct klogrec {
+  uint seq;          // Order across all CPUs, from 1
+  uint ticks;        // Time logged
+  ushort cpu;        // CPU that logged it
+  ushort len;        // Bytes in text, not counting the NUL
+  char text[KLOGTEXT];
+};
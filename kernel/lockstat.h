@@ -0,0 +1,12 @@
+// Lock statistics for one class of spinlocks (all the locks
+// sharing a name), as returned by the lockstat system call.
+
+#define NLOCKCLASS 64   // most classes lockstat returns
+
+struct lockstat {
+  char name[16];
+  uint nacquire;     // Acquisitions
+  uint ncontended;   // Acquisitions that had to wait
+  uint nspin;        // Iterations spent waiting
+  uint maxhold;      // Longest hold, in TSC cycles
+};
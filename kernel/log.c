@@ -1,11 +1,15 @@
 #include "types.h"
 #include "defs.h"
 #include "param.h"
+#include "mmu.h"
+#include "proc.h"
 #include "spinlock.h"
 #include "sleeplock.h"
 #include "fs.h"
 #include "buf.h"
 
+#define LOGDEFERTICKS 100  // longest a commit is put off (1 second)
+
 // Simple logging that allows concurrent FS system calls.
 //
 // A log transaction contains the updates of multiple FS system
@@ -20,6 +24,25 @@
 // But if it thinks the log is close to running out, it
 // sleeps until the last outstanding end_op() commits.
 //
+// begin_op() reserves log space for the worst case of
+// MAXOPBLOCKS blocks. An op that knows it will write fewer
+// blocks (e.g. a small write()) can call begin_op_reserve()
+// instead, so that more ops fit in the log at once.
+//
+// A large write() is split into ops of up to log_maxop()
+// blocks, half the log.  end_op_defer() lets consecutive
+// writes to the same file share one transaction: when such
+// a write is the last outstanding op, the commit is put off.
+// The transaction commits when the last op ends if any op in
+// it could not defer, when a new op needs the log space, or
+// once it has waited LOGDEFERTICKS, by the logflush kernel
+// process if no op ends sooner.  Each op is still atomic;
+// only durability waits, and only for a bounded time.
+//
+// The size of the log comes from the superblock, limited by
+// what one header block can describe and by the number of
+// buffers that logged blocks may pin in the buffer cache.
+//
 // The log is a physical re-do log containing disk blocks.
 // The on-disk log format:
 //   header block, containing block #s for block A, B, C, ...
@@ -33,15 +56,19 @@
 // and to keep track in memory of logged block# before commit.
 struct logheader {
   int n;
-  int block[LOGSIZE];
+  int block[MAXLOGBLOCKS];
 };
 
 struct log {
   struct spinlock lock;
   int start;
-  int size;
+  int size;        // data blocks in the log, not counting the header
   int outstanding; // how many FS sys calls are executing.
+  int reserved;    // log blocks reserved by outstanding FS sys calls.
   int committing;  // in commit(), please wait.
+  void *deferkey;  // file whose writes fill an uncommitted transaction
+  uint defertick;  // when the commit was first put off
+  int nodefer;     // an op that cannot defer is in this transaction
   int dev;
   struct logheader lh;
 };
@@ -53,14 +80,22 @@ static void commit();
 void
 initlog(int dev)
 {
-  if (sizeof(struct logheader) >= BSIZE)
+  if (sizeof(struct logheader) > BSIZE)
     panic("initlog: too big logheader");
 
   struct superblock sb;
   initlock(&log.lock, "log");
   readsb(dev, &sb);
   log.start = sb.logstart;
-  log.size = sb.nlog;
+  log.size = sb.nlog - 1;
+  if(log.size > MAXLOGBLOCKS)
+    log.size = MAXLOGBLOCKS;
+  // Logged blocks stay in the buffer cache until commit;
+  // leave room for the buffers that ops use without logging.
+  if(log.size > NBUF - MAXOPBLOCKS)
+    log.size = NBUF - MAXOPBLOCKS;
+  if(log.size < MAXOPBLOCKS)
+    panic("initlog: log too small");
   log.dev = dev;
   recover_from_log();
 }
@@ -88,6 +123,8 @@ read_head(void)
   struct buf *buf = bread(log.dev, log.start);
   struct logheader *lh = (struct logheader *) (buf->data);
   int i;
+  if(lh->n < 0 || lh->n > MAXLOGBLOCKS)
+    panic("read_head: bad log header");
   log.lh.n = lh->n;
   for (i = 0; i < log.lh.n; i++) {
     log.lh.block[i] = lh->block[i];
@@ -121,19 +158,62 @@ recover_from_log(void)
   write_head(); // clear the log
 }
 
+// Most blocks a single op should reserve.
+int
+log_maxop(void)
+{
+  return log.size/2 > MAXOPBLOCKS ? log.size/2 : MAXOPBLOCKS;
+}
+
+// Commit the current transaction.  Caller holds log.lock,
+// which commit releases while it writes; no ops may be
+// outstanding.
+static void
+docommit(void)
+{
+  log.committing = 1;
+  release(&log.lock);
+  // call commit w/o holding locks, since not allowed
+  // to sleep with locks.
+  commit();
+  acquire(&log.lock);
+  log.committing = 0;
+  log.deferkey = 0;
+  log.nodefer = 0;
+  wakeup(&log);
+}
+
 // called at the start of each FS system call.
 void
 begin_op(void)
 {
+  begin_op_reserve(MAXOPBLOCKS);
+}
+
+// called at the start of an FS system call that will
+// write at most nblocks distinct blocks.
+void
+begin_op_reserve(int nblocks)
+{
+  if(nblocks < 1 || nblocks > log.size)
+    panic("begin_op_reserve");
+
   acquire(&log.lock);
   while(1){
     if(log.committing){
       sleep(&log, &log.lock);
-    } else if(log.lh.n + (log.outstanding+1)*MAXOPBLOCKS > LOGSIZE){
-      // this op might exhaust log space; wait for commit.
-      sleep(&log, &log.lock);
+    } else if(log.lh.n + log.reserved + nblocks > log.size){
+      if(log.outstanding == 0){
+        // only a deferred transaction holds the space.
+        docommit();
+      } else {
+        // this op might exhaust log space; wait for commit.
+        sleep(&log, &log.lock);
+      }
     } else {
       log.outstanding += 1;
+      log.reserved += nblocks;
+      myproc()->logresv = nblocks;
       release(&log.lock);
       break;
     }
@@ -145,34 +225,69 @@ begin_op(void)
 void
 end_op(void)
 {
-  int do_commit = 0;
+  end_op_defer(0);
+}
 
+// called at the end of an FS system call that wrote to the
+// file identified by key.  If this was the last outstanding
+// operation and the log has room for another op, leave the
+// transaction uncommitted for a following write to key.
+void
+end_op_defer(void *key)
+{
   acquire(&log.lock);
   log.outstanding -= 1;
+  log.reserved -= myproc()->logresv;
+  myproc()->logresv = 0;
   if(log.committing)
     panic("log.committing");
+  if(key == 0 || (log.deferkey && log.deferkey != key))
+    log.nodefer = 1;
   if(log.outstanding == 0){
-    do_commit = 1;
-    log.committing = 1;
+    if(key && !log.nodefer && log.lh.n + log_maxop() <= log.size &&
+       (log.deferkey == 0 || ticks - log.defertick < LOGDEFERTICKS)){
+      if(log.deferkey == 0)
+        log.defertick = ticks;
+      log.deferkey = key;
+      wakeup(&log);
+    } else {
+      docommit();
+    }
   } else {
     // begin_op() may be waiting for log space,
-    // and decrementing log.outstanding has decreased
+    // and decrementing log.reserved has decreased
     // the amount of reserved space.
     wakeup(&log);
   }
   release(&log.lock);
+}
 
-  if(do_commit){
-    // call commit w/o holding locks, since not allowed
-    // to sleep with locks.
-    commit();
-    acquire(&log.lock);
-    log.committing = 0;
-    wakeup(&log);
-    release(&log.lock);
+// Body of the logflush kernel process: commit a deferred
+// transaction that has waited LOGDEFERTICKS with no op to
+// end it.  logtick() wakes it.
+void
+logflusher(void)
+{
+  acquire(&log.lock);
+  for(;;){
+    if(log.deferkey && log.outstanding == 0 && !log.committing &&
+       ticks - log.defertick >= LOGDEFERTICKS)
+      docommit();
+    else
+      sleep(&log.defertick, &log.lock);
   }
 }
 
+// Called by the timer interrupt on CPU 0.  Reads log
+// fields without the lock; a missed wakeup is retried on
+// the next tick.
+void
+logtick(uint now)
+{
+  if(log.deferkey && now - log.defertick >= LOGDEFERTICKS)
+    wakeup(&log.defertick);
+}
+
 // Copy modified blocks from cache to log.
 static void
 write_log(void)
@@ -215,7 +330,7 @@ log_write(struct buf *b)
 {
   int i;
 
-  if (log.lh.n >= LOGSIZE || log.lh.n >= log.size - 1)
+  if (log.lh.n >= log.size)
     panic("too big a transaction");
   if (log.outstanding < 1)
     panic("log_write outside of trans");
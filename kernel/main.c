@@ -28,7 +28,10 @@ main(void)
   uartinit();      // serial port
   pinit();         // process table
   tvinit();        // trap vectors
+  profinit();      // sampling profiler
+  vdsoinit();      // time page shared with user space
   binit();         // buffer cache
+  dcacheinit();    // directory entry cache
   fileinit();      // file table
   ideinit();       // disk 
   startothers();   // start other processors
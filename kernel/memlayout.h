@@ -8,6 +8,13 @@
 #define KERNBASE 0x80000000         // First kernel virtual address
 #define KERNLINK (KERNBASE+EXTMEM)  // Address where kernel is linked
 
+// Pages the kernel maps into every user address space sit
+// just below KERNBASE; user memory must stay under USERTOP.
+#define URING   (KERNBASE-0x1000)   // System call ring (see ring.h)
+#define VTIME   (KERNBASE-0x2000)   // Shared time page (see vdso.h)
+#define VPROC   (KERNBASE-0x3000)   // Per-process page (see vdso.h)
+#define USERTOP VPROC
+
 #define V2P(a) (((uint) (a)) - KERNBASE)
 #define P2V(a) ((void *)(((char *) (a)) + KERNBASE))
 
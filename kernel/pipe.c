@@ -8,17 +8,69 @@
 #include "sleeplock.h"
 #include "file.h"
 
-#define PIPESIZE 512
+// The pipe buffer is a ring of separately allocated pages.
+// Its size is a power of two, so that byte positions can run
+// freely and wrap around the ring consistently.
+#define PIPEPAGES    4    // default size, in pages
+#define PIPEMAXPAGES 16   // largest size F_SETPIPE_SZ allows
 
 struct pipe {
   struct spinlock lock;
-  char data[PIPESIZE];
+  char *page[PIPEMAXPAGES];
+  uint size;      // bytes in the ring
   uint nread;     // number of bytes read
   uint nwrite;    // number of bytes written
   int readopen;   // read fd is still open
   int writeopen;  // write fd is still open
+  int wbusy;      // a splice is filling the ring (see pipewbegin)
+  int rbusy;      // a splice is draining the ring (see piperbegin)
 };
 
+// Address of byte i of the stream in p's ring.
+static char*
+pipebyte(struct pipe *p, uint i)
+{
+  i %= p->size;
+  return &p->page[i / PGSIZE][i % PGSIZE];
+}
+
+// Number of bytes, at most n, that lie contiguously in one
+// page of the ring starting at stream position i.  Every
+// ring size is a multiple of PGSIZE, so this is the same
+// for rings of any size.
+static uint
+span(uint i, uint n)
+{
+  uint m;
+
+  m = PGSIZE - i % PGSIZE;
+  return n < m ? n : m;
+}
+
+static void
+freepages(char **page, int npage)
+{
+  int i;
+
+  for(i = 0; i < npage; i++)
+    if(page[i])
+      kfree(page[i]);
+}
+
+static int
+allocpages(char **page, int npage)
+{
+  int i;
+
+  for(i = 0; i < npage; i++){
+    if((page[i] = kalloc()) == 0){
+      freepages(page, i);
+      return -1;
+    }
+  }
+  return 0;
+}
+
 int
 pipealloc(struct file **f0, struct file **f1)
 {
@@ -30,6 +82,10 @@ pipealloc(struct file **f0, struct file **f1)
     goto bad;
   if((p = (struct pipe*)kalloc()) == 0)
     goto bad;
+  memset(p, 0, sizeof(*p));
+  if(allocpages(p->page, PIPEPAGES) < 0)
+    goto bad;
+  p->size = PIPEPAGES*PGSIZE;
   p->readopen = 1;
   p->writeopen = 1;
   p->nwrite = 0;
@@ -47,8 +103,10 @@ pipealloc(struct file **f0, struct file **f1)
 
 //PAGEBREAK: 20
  bad:
-  if(p)
+  if(p){
+    freepages(p->page, PIPEMAXPAGES);
     kfree((char*)p);
+  }
   if(*f0)
     fileclose(*f0);
   if(*f1)
@@ -69,6 +127,7 @@ pipeclose(struct pipe *p, int writable)
   }
   if(p->readopen == 0 && p->writeopen == 0){
     release(&p->lock);
+    freepages(p->page, PIPEMAXPAGES);
     kfree((char*)p);
   } else
     release(&p->lock);
@@ -78,11 +137,11 @@ pipeclose(struct pipe *p, int writable)
 int
 pipewrite(struct pipe *p, char *addr, int n)
 {
-  int i;
+  int i, m;
 
   acquire(&p->lock);
-  for(i = 0; i < n; i++){
-    while(p->nwrite == p->nread + PIPESIZE){  //DOC: pipewrite-full
+  for(i = 0; i < n; i += m){
+    while(p->nwrite == p->nread + p->size || p->wbusy){  //DOC: pipewrite-full
       if(p->readopen == 0 || myproc()->killed){
         release(&p->lock);
         return -1;
@@ -90,7 +149,12 @@ pipewrite(struct pipe *p, char *addr, int n)
       wakeup(&p->nread);
       sleep(&p->nwrite, &p->lock);  //DOC: pipewrite-sleep
     }
-    p->data[p->nwrite++ % PIPESIZE] = addr[i];
+    // Fill as much free space as possible, a page at a time.
+    m = span(p->nwrite, p->size - (p->nwrite - p->nread));
+    if(m > n - i)
+      m = n - i;
+    memmove(pipebyte(p, p->nwrite), addr + i, m);
+    p->nwrite += m;
   }
   wakeup(&p->nread);  //DOC: pipewrite-wakeup1
   release(&p->lock);
@@ -100,22 +164,166 @@ pipewrite(struct pipe *p, char *addr, int n)
 int
 piperead(struct pipe *p, char *addr, int n)
 {
-  int i;
+  int i, m;
 
   acquire(&p->lock);
-  while(p->nread == p->nwrite && p->writeopen){  //DOC: pipe-empty
+  while((p->nread == p->nwrite && p->writeopen) || p->rbusy){  //DOC: pipe-empty
     if(myproc()->killed){
       release(&p->lock);
       return -1;
     }
     sleep(&p->nread, &p->lock); //DOC: piperead-sleep
   }
-  for(i = 0; i < n; i++){  //DOC: piperead-copy
-    if(p->nread == p->nwrite)
-      break;
-    addr[i] = p->data[p->nread++ % PIPESIZE];
+  for(i = 0; i < n && p->nread != p->nwrite; i += m){  //DOC: piperead-copy
+    m = span(p->nread, p->nwrite - p->nread);
+    if(m > n - i)
+      m = n - i;
+    memmove(addr + i, pipebyte(p, p->nread), m);
+    p->nread += m;
   }
   wakeup(&p->nwrite);  //DOC: piperead-wakeup
   release(&p->lock);
   return i;
 }
+
+// Would piperead() return without waiting?
+int
+pipecanread(struct pipe *p)
+{
+  int r;
+
+  acquire(&p->lock);
+  r = p->nread != p->nwrite || !p->writeopen;
+  release(&p->lock);
+  return r;
+}
+
+int
+pipegetsize(struct pipe *p)
+{
+  return p->size;
+}
+
+// Resize p's ring to hold at least n bytes, keeping its
+// contents.  Returns the new size, or -1 if n is too large
+// or smaller than the data in the pipe, or a splice is
+// using the ring.
+int
+pipesetsize(struct pipe *p, int n)
+{
+  char *page[PIPEMAXPAGES], *old[PIPEMAXPAGES];
+  uint npage, oldsize, i, m;
+
+  if(n < 0 || n > PIPEMAXPAGES*PGSIZE)
+    return -1;
+  for(npage = 1; npage*PGSIZE < n; npage *= 2)
+    ;
+  memset(page, 0, sizeof(page));
+  if(allocpages(page, npage) < 0)
+    return -1;
+  acquire(&p->lock);
+  if(p->nwrite - p->nread > npage*PGSIZE || p->wbusy || p->rbusy){
+    release(&p->lock);
+    freepages(page, npage);
+    return -1;
+  }
+  // Copy the unread bytes to the same stream positions
+  // in the new ring.
+  memmove(old, p->page, sizeof(old));
+  oldsize = p->size;
+  memmove(p->page, page, sizeof(page));
+  p->size = npage*PGSIZE;
+  for(i = p->nread; i != p->nwrite; i += m){
+    m = span(i, p->nwrite - i);
+    memmove(pipebyte(p, i), old[(i % oldsize) / PGSIZE] + i % PGSIZE, m);
+  }
+  n = p->size;
+  // A bigger ring may let a blocked writer continue.
+  wakeup(&p->nwrite);
+  release(&p->lock);
+  freepages(old, PIPEMAXPAGES);
+  return n;
+}
+
+//PAGEBREAK: 40
+// splice() moves data between a pipe and an inode by having
+// readi() and writei() work directly on the ring, which
+// means releasing p->lock while they sleep.  To do that, a
+// splice claims the free (or filled) span at the write (or
+// read) end with pipewbegin() (or piperbegin()), which sets
+// wbusy (or rbusy) to keep other writers (or readers) out,
+// and finishes with pipewend() (or piperend()).
+
+// Wait for free space in p and claim up to n bytes of it.
+// Sets *pp to the claimed span and returns its length, or
+// returns -1 if the reader has gone or we were killed.
+int
+pipewbegin(struct pipe *p, char **pp, int n)
+{
+  acquire(&p->lock);
+  while(p->nwrite == p->nread + p->size || p->wbusy){
+    if(p->readopen == 0 || myproc()->killed){
+      release(&p->lock);
+      return -1;
+    }
+    wakeup(&p->nread);
+    sleep(&p->nwrite, &p->lock);
+  }
+  p->wbusy = 1;
+  *pp = pipebyte(p, p->nwrite);
+  n = span(p->nwrite, n < p->size - (p->nwrite - p->nread) ?
+           n : p->size - (p->nwrite - p->nread));
+  release(&p->lock);
+  return n;
+}
+
+// Publish the first n bytes of the span claimed by
+// pipewbegin() and drop the claim.
+void
+pipewend(struct pipe *p, int n)
+{
+  acquire(&p->lock);
+  p->nwrite += n;
+  p->wbusy = 0;
+  wakeup(&p->nread);
+  wakeup(&p->nwrite);
+  release(&p->lock);
+}
+
+// Wait for data in p and claim up to n bytes of it.  Sets
+// *pp to the claimed span and returns its length; returns 0,
+// claiming nothing, at end of file, and -1 if we were killed.
+int
+piperbegin(struct pipe *p, char **pp, int n)
+{
+  acquire(&p->lock);
+  while((p->nread == p->nwrite && p->writeopen) || p->rbusy){
+    if(myproc()->killed){
+      release(&p->lock);
+      return -1;
+    }
+    sleep(&p->nread, &p->lock);
+  }
+  if(p->nread == p->nwrite){
+    release(&p->lock);
+    return 0;
+  }
+  p->rbusy = 1;
+  *pp = pipebyte(p, p->nread);
+  n = span(p->nread, n < p->nwrite - p->nread ? n : p->nwrite - p->nread);
+  release(&p->lock);
+  return n;
+}
+
+// Consume the first n bytes of the span claimed by
+// piperbegin() and drop the claim.
+void
+piperend(struct pipe *p, int n)
+{
+  acquire(&p->lock);
+  p->nread += n;
+  p->rbusy = 0;
+  wakeup(&p->nwrite);
+  wakeup(&p->nread);
+  release(&p->lock);
+}
@@ -98,6 +98,9 @@ found:
   p->rtime = 0;
   p->wtime = 0;
   p->stime = 0;
+  p->ring = 0;
+  p->ofile = p->ofile0;
+  p->nofile = NOFILE;
 
   release(&ptable.lock);
 
@@ -139,6 +142,8 @@ userinit(void)
   if((p->pgdir = setupkvm()) == 0)
     panic("userinit: out of memory?");
   inituvm(p->pgdir, _binary_initcode_start, (int)_binary_initcode_size);
+  if(mapvdso(p->pgdir, p->pid) < 0)
+    panic("userinit: out of memory?");
   p->sz = PGSIZE;
   memset(p->tf, 0, sizeof(*p->tf));
   p->tf->cs = (SEG_UCODE << 3) | DPL_USER;
@@ -167,6 +172,24 @@ userinit(void)
   release(&ptable.lock);
 }
 
+// Start a kernel process that runs fn, which must never
+// return, instead of returning to user space.
+void
+kproc(char *name, void (*fn)(void))
+{
+  struct proc *p;
+
+  if((p = allocproc()) == 0 || (p->pgdir = setupkvm()) == 0)
+    panic("kproc");
+  // forkret returns into fn instead of trapret (see allocproc).
+  *(uint*)(p->context + 1) = (uint)fn;
+  safestrcpy(p->name, name, sizeof(p->name));
+
+  acquire(&ptable.lock);
+  p->state = RUNNABLE;
+  release(&ptable.lock);
+}
+
 // Grow current process's memory by n bytes.
 // Return 0 on success, -1 on failure.
 int
@@ -204,7 +227,11 @@ fork(void)
   }
 
   // Copy process state from proc.
-  if((np->pgdir = copyuvm(curproc->pgdir, curproc->sz)) == 0){
+  if((np->pgdir = copyuvm(curproc->pgdir, curproc->sz)) == 0 ||
+     mapvdso(np->pgdir, np->pid) < 0){
+    if(np->pgdir)
+      freevm(np->pgdir);
+    np->pgdir = 0;
     kfree(np->kstack);
     np->kstack = 0;
     np->state = UNUSED;
@@ -220,17 +247,26 @@ fork(void)
   // Clear %eax so that fork returns 0 in the child.
   np->tf->eax = 0;
 
-  for(i = 0; i < NOFILE; i++)
+  safestrcpy(np->name, curproc->name, sizeof(curproc->name));
+
+  if(curproc->nofile > np->nofile && growofile(np) < 0){
+    freevm(np->pgdir);
+    np->pgdir = 0;
+    kfree(np->kstack);
+    np->kstack = 0;
+    np->state = UNUSED;
+    return -1;
+  }
+  for(i = 0; i < curproc->nofile; i++)
     if(curproc->ofile[i])
       np->ofile[i] = filedup(curproc->ofile[i]);
   np->cwd = idup(curproc->cwd);
 
-  safestrcpy(np->name, curproc->name, sizeof(curproc->name));
-
   pid = np->pid;
 
   acquire(&ptable.lock);
 
+  np->trace = systrace_dup(curproc->trace);
   np->state = RUNNABLE;
 
   release(&ptable.lock);
@@ -238,6 +274,26 @@ fork(void)
   return pid;
 }
 
+// Grow p's open file table from the initial NOFILE slots
+// to MAXOFILE, a page of pointers.
+int
+growofile(struct proc *p)
+{
+  struct file **ofile;
+
+  if(p->ofile != p->ofile0)
+    return -1;
+  if((ofile = (struct file**)kalloc()) == 0)
+    return -1;
+  memset(ofile, 0, PGSIZE);
+  memmove(ofile, p->ofile0, sizeof(p->ofile0));
+  memset(p->ofile0, 0, sizeof(p->ofile0));
+  p->ofile = ofile;
+  p->nofile = MAXOFILE;
+  klog("pid %d %s: fd table grown to %d", p->pid, p->name, MAXOFILE);
+  return 0;
+}
+
 // Exit the current process.  Does not return.
 // An exited process remains in the zombie state
 // until its parent calls wait() to find out it exited.
@@ -252,12 +308,17 @@ exit(void)
     panic("init exiting");
 
   // Close all open files.
-  for(fd = 0; fd < NOFILE; fd++){
+  for(fd = 0; fd < curproc->nofile; fd++){
     if(curproc->ofile[fd]){
       fileclose(curproc->ofile[fd]);
       curproc->ofile[fd] = 0;
     }
   }
+  if(curproc->ofile != curproc->ofile0){
+    kfree((char*)curproc->ofile);
+    curproc->ofile = curproc->ofile0;
+    curproc->nofile = NOFILE;
+  }
 
   begin_op();
   iput(curproc->cwd);
@@ -307,6 +368,8 @@ wait(void)
         kfree(p->kstack);
         p->kstack = 0;
         freevm(p->pgdir);
+        systrace_put(p->trace);
+        p->trace = 0;
         p->pid = 0;
         p->parent = 0;
         p->name[0] = 0;
@@ -354,6 +417,8 @@ waitx(int *wtime, int *rtime)
         kfree(p->kstack);
         p->kstack = 0;
         freevm(p->pgdir);
+        systrace_put(p->trace);
+        p->trace = 0;
         p->state = UNUSED;
         p->pid = 0;
         p->parent = 0;
@@ -481,6 +546,9 @@ forkret(void)
     first = 0;
     iinit(ROOTDEV);
     initlog(ROOTDEV);
+    allocinit(ROOTDEV);
+    // Started only now, so it cannot run this block itself.
+    kproc("logflush", logflusher);
   }
 
   // Return to "caller", actually trapret (see allocproc).
@@ -570,6 +638,58 @@ kill(int pid)
   return -1;
 }
 
+// Start collecting system call statistics for process pid
+// and the children it forks from now on.
+int
+trace(int pid)
+{
+  struct proc *p;
+  struct systrace *t;
+
+  if((t = systrace_alloc()) == 0)
+    return -1;
+  acquire(&ptable.lock);
+  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
+    if(p->pid == pid && p->state != UNUSED && p->state != ZOMBIE){
+      if(p->trace == 0){
+        p->trace = t;
+        t = 0;
+      }
+      release(&ptable.lock);
+      systrace_put(t);
+      return 0;
+    }
+  }
+  release(&ptable.lock);
+  systrace_put(t);
+  return -1;
+}
+
+// Copy the system call statistics of traced process pid, or
+// the global statistics if pid is 0, to st.
+int
+sysstat(int pid, struct sysstat *st)
+{
+  struct proc *p;
+  struct systrace *t;
+
+  if(pid == 0){
+    systrace_read(0, st);
+    return 0;
+  }
+  t = 0;
+  acquire(&ptable.lock);
+  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++)
+    if(p->pid == pid && p->state != UNUSED)
+      t = systrace_dup(p->trace);
+  release(&ptable.lock);
+  if(t == 0)
+    return -1;
+  systrace_read(t, st);
+  systrace_put(t);
+  return 0;
+}
+
 //PAGEBREAK: 36
 // Print a process listing to console.  For debugging.
 // Runs when user types ^P on console.
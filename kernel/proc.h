@@ -46,13 +46,18 @@ struct proc {
   struct context *context;     // swtch() here to run process
   void *chan;                  // If non-zero, sleeping on chan
   int killed;                  // If non-zero, have been killed
-  struct file *ofile[NOFILE];  // Open files
+  struct file **ofile;         // Open files: ofile0, or a page once grown
+  int nofile;                  // Slots in ofile
+  struct file *ofile0[NOFILE];
   struct inode *cwd;           // Current directory
+  int logresv;                 // Log blocks reserved by the current FS op
   char name[16];
   int gid;                     // Process group ID
   int rtime;                   // CPU running time (ticks in RUNNING)
   int wtime;                   // waiting/ready time (ticks in RUNNABLE)
   int stime;               // Process name (debugging)
+  struct systrace *trace;      // System call statistics, if traced
+  struct ring *ring;           // Mapped at URING, if set up
 };
 
 // Process memory is laid out contiguously, low addresses first:
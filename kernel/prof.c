@@ -0,0 +1,150 @@
+// Kernel sampling profiler.
+//
+// While profiling is on, the timer interrupt on each CPU calls
+// profsample(), which records the interrupted eip, the CPU and
+// the running process in that CPU's ring.  User programs start
+// and stop sampling with profctl() and drain the rings with
+// profread(); kprof turns the samples into a flat profile.
+// Each ring has its own lock, so CPUs never contend while
+// sampling.  A full ring drops new samples and counts them.
+// The rings' pages are allocated by the first PROF_START, so
+// a kernel that never profiles does not pay for them.
+//
+// The ring locks are spinlocks of class "prof", acquired on
+// every tick while profiling, so they show up in lockstat's
+// output taken over the same period.
+
+#include "types.h"
+#include "defs.h"
+#include "param.h"
+#include "memlayout.h"
+#include "mmu.h"
+#include "proc.h"
+#include "x86.h"
+#include "spinlock.h"
+#include "prof.h"
+
+#define PERPAGE    (PGSIZE / sizeof(struct profsample))
+#define NPROFPAGES ((NPROFSAMPLE + PERPAGE - 1) / PERPAGE)
+
+struct profbuf {
+  struct spinlock lock;
+  uint r;                 // samples read
+  uint w;                 // samples written
+  uint dropped;
+  struct profsample *page[NPROFPAGES];
+};
+
+static struct profbuf profbuf[NCPU];
+static int profiling;
+
+void
+profinit(void)
+{
+  int i;
+
+  for(i = 0; i < NCPU; i++)
+    initlock(&profbuf[i].lock, "prof");
+}
+
+// Sample number i of pb's ring.
+static struct profsample*
+slot(struct profbuf *pb, uint i)
+{
+  i %= NPROFSAMPLE;
+  return &pb->page[i / PERPAGE][i % PERPAGE];
+}
+
+// Allocate any ring pages not yet allocated.
+static int
+profalloc(void)
+{
+  struct profbuf *pb;
+  int i, ok;
+
+  ok = 0;
+  for(pb = profbuf; pb < &profbuf[ncpu]; pb++){
+    acquire(&pb->lock);
+    for(i = 0; i < NPROFPAGES; i++)
+      if(pb->page[i] == 0 && (pb->page[i] = (struct profsample*)kalloc()) == 0)
+        ok = -1;
+    release(&pb->lock);
+  }
+  return ok;
+}
+
+// Record a sample for the timer interrupt described by tf.
+// Called with interrupts off.
+void
+profsample(struct trapframe *tf)
+{
+  struct profbuf *pb;
+  struct profsample *s;
+  struct proc *p;
+
+  if(!profiling)
+    return;
+  pb = &profbuf[cpuid()];
+  p = myproc();
+  acquire(&pb->lock);
+  if(pb->w - pb->r == NPROFSAMPLE){
+    pb->dropped++;
+  } else {
+    s = slot(pb, pb->w++);
+    s->eip = tf->eip;
+    s->cpu = cpuid();
+    s->user = (tf->cs & 3) == DPL_USER;
+    s->pid = p ? p->pid : 0;
+  }
+  release(&pb->lock);
+}
+
+int
+profctl(int cmd)
+{
+  struct profbuf *pb;
+  int n;
+
+  switch(cmd){
+  case PROF_STOP:
+    profiling = 0;
+    return 0;
+  case PROF_START:
+    if(profalloc() < 0)
+      return -1;
+    for(pb = profbuf; pb < &profbuf[ncpu]; pb++){
+      acquire(&pb->lock);
+      pb->r = pb->w = pb->dropped = 0;
+      release(&pb->lock);
+    }
+    profiling = 1;
+    return 0;
+  case PROF_DROPPED:
+    n = 0;
+    for(pb = profbuf; pb < &profbuf[ncpu]; pb++){
+      acquire(&pb->lock);
+      n += pb->dropped;
+      release(&pb->lock);
+    }
+    return n;
+  }
+  return -1;
+}
+
+// Move up to n samples, from all CPUs, into s.
+// Returns the number moved.
+int
+profread(struct profsample *s, int n)
+{
+  struct profbuf *pb;
+  int k;
+
+  k = 0;
+  for(pb = profbuf; pb < &profbuf[ncpu]; pb++){
+    acquire(&pb->lock);
+    while(k < n && pb->r != pb->w)
+      s[k++] = *slot(pb, pb->r++);
+    release(&pb->lock);
+  }
+  return k;
+}
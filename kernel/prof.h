@@ -0,0 +1,16 @@
+// Kernel sampling profiler: while it is on, every CPU's timer
+// interrupt records where that CPU was running.
+
+#define NPROFSAMPLE 4096  // samples buffered per CPU
+
+// profctl() commands
+#define PROF_STOP     0   // stop sampling
+#define PROF_START    1   // discard old samples and start sampling
+#define PROF_DROPPED  2   // samples lost to full buffers since start
+
+struct profsample {
+  uint eip;          // Interrupted instruction
+  ushort cpu;        // CPU that took the sample
+  ushort user;       // Interrupted in user mode?
+  int pid;           // Running process, or 0 if none
+};
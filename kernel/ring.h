@@ -0,0 +1,37 @@
+// System call ring: a page shared between a process and the
+// kernel.  The process queues operations on sq and advances
+// stail, then calls ringenter() to run everything queued;
+// the kernel posts one completion per operation on cq,
+// advancing ctail, and the process consumes them by
+// advancing chead.  Indices run freely and are taken
+// modulo NRING.
+
+#define NRING 128
+
+// ringsqe.op values
+#define RING_NOP    0
+#define RING_READ   1
+#define RING_WRITE  2
+#define RING_CLOSE  3
+
+struct ringsqe {
+  int op;
+  int fd;
+  uint addr;        // user buffer for RING_READ and RING_WRITE
+  int n;
+  uint data;        // copied to the completion
+};
+
+struct ringcqe {
+  uint data;
+  int res;          // what the equivalent system call returns
+};
+
+struct ring {
+  uint shead;       // advanced by the kernel
+  uint stail;       // advanced by the process
+  uint chead;       // advanced by the process
+  uint ctail;       // advanced by the kernel
+  struct ringsqe sq[NRING];
+  struct ringcqe cq[NRING];
+};
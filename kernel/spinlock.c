@@ -1,4 +1,14 @@
 // Mutual exclusion spin locks.
+//
+// These are ticket locks: acquire() takes the next ticket and
+// waits for owner to reach it, so CPUs get the lock in the order
+// they asked for it, and waiters only read the lock's cache
+// line instead of hammering it with atomic exchanges.
+//
+// Each lock also counts acquisitions, contention and hold times
+// into per-CPU counters for its class: all locks with the same
+// name, such as every pipe's lock.  The lockstat system call
+// sums them over CPUs.
 
 #include "types.h"
 #include "defs.h"
@@ -8,13 +18,49 @@
 #include "mmu.h"
 #include "proc.h"
 #include "spinlock.h"
+#include "lockstat.h"
+
+// Class names; slot 0 collects locks whose class is unknown.
+static char *classname[NLOCKCLASS] = { "other" };
+
+struct lockcount {
+  uint nacquire;
+  uint ncontended;
+  uint nspin;
+  uint maxhold;
+};
+
+// Only ever updated by the CPU owning the row, with
+// interrupts off, so no atomic operations are needed.
+static struct lockcount lockcount[NCPU][NLOCKCLASS];
+
+// Find or make the class for locks named name.  Slots are
+// claimed with an atomic compare-and-swap, so this needs no
+// lock and can run concurrently on several CPUs.
+static int
+lockclass(char *name)
+{
+  int i;
+
+  for(i = 1; i < NLOCKCLASS; i++){
+    if(classname[i] == 0 &&
+       __sync_bool_compare_and_swap(&classname[i], 0, name))
+      return i;
+    if(classname[i] == name || strncmp(classname[i], name, 16) == 0)
+      return i;
+  }
+  return 0;
+}
 
 void
 initlock(struct spinlock *lk, char *name)
 {
   lk->name = name;
+  lk->next = 0;
+  lk->owner = 0;
   lk->locked = 0;
   lk->cpu = 0;
+  lk->class = lockclass(name);
 }
 
 // Acquire the lock.
@@ -24,33 +70,55 @@ initlock(struct spinlock *lk, char *name)
 void
 acquire(struct spinlock *lk)
 {
+  uint ticket, spins;
+  struct lockcount *lc;
+
   pushcli(); // disable interrupts to avoid deadlock.
   if(holding(lk))
     panic("acquire");
 
-  // The xchg is atomic.
-  while(xchg(&lk->locked, 1) != 0)
-    ;
+  // The fetch-and-add is atomic.
+  ticket = __sync_fetch_and_add(&lk->next, 1);
+  for(spins = 0; *(volatile uint*)&lk->owner != ticket; spins++)
+    pause();
 
   // Tell the C compiler and the processor to not move loads or stores
   // past this point, to ensure that the critical section's memory
   // references happen after the lock is acquired.
   __sync_synchronize();
+  lk->locked = 1;
 
   // Record info about lock acquisition for debugging.
   lk->cpu = mycpu();
   getcallerpcs(&lk, lk->pcs);
+
+  lc = &lockcount[cpuid()][lk->class];
+  lc->nacquire++;
+  if(spins){
+    lc->ncontended++;
+    lc->nspin += spins;
+  }
+  lk->tacquire = rdtsc();
 }
 
 // Release the lock.
 void
 release(struct spinlock *lk)
 {
+  uint hold;
+  struct lockcount *lc;
+
   if(!holding(lk))
     panic("release");
 
+  hold = rdtsc() - lk->tacquire;
+  lc = &lockcount[cpuid()][lk->class];
+  if(hold > lc->maxhold)
+    lc->maxhold = hold;
+
   lk->pcs[0] = 0;
   lk->cpu = 0;
+  lk->locked = 0;
 
   // Tell the C compiler and the processor to not move loads or stores
   // past this point, to ensure that all the stores in the critical
@@ -59,14 +127,40 @@ release(struct spinlock *lk)
   // stores; __sync_synchronize() tells them both not to.
   __sync_synchronize();
 
-  // Release the lock, equivalent to lk->locked = 0.
-  // This code can't use a C assignment, since it might
-  // not be atomic. A real OS would use C atomics here.
-  asm volatile("movl $0, %0" : "+m" (lk->locked) : );
+  // Serve the next ticket.  Only the holder writes owner, so a
+  // plain (but not reordered or split) store suffices.
+  *(volatile uint*)&lk->owner = lk->owner + 1;
 
   popcli();
 }
 
+// Copy the statistics of up to n lock classes to st,
+// summed over CPUs.  Returns the number copied.
+int
+lockstats(struct lockstat *st, int n)
+{
+  int i, c, k;
+  struct lockcount *lc;
+
+  k = 0;
+  for(i = 0; i < NLOCKCLASS && k < n; i++){
+    if(classname[i] == 0)
+      continue;
+    memset(&st[k], 0, sizeof(st[k]));
+    safestrcpy(st[k].name, classname[i], sizeof(st[k].name));
+    for(c = 0; c < ncpu; c++){
+      lc = &lockcount[c][i];
+      st[k].nacquire += lc->nacquire;
+      st[k].ncontended += lc->ncontended;
+      st[k].nspin += lc->nspin;
+      if(lc->maxhold > st[k].maxhold)
+        st[k].maxhold = lc->maxhold;
+    }
+    k++;
+  }
+  return k;
+}
+
 // Record the current call stack in pcs[] by following the %ebp chain.
 void
 getcallerpcs(void *v, uint pcs[])
@@ -1,5 +1,7 @@
 // Mutual exclusion lock.
 struct spinlock {
+  uint next;         // Next ticket to hand out
+  uint owner;        // Ticket of the current (or next) holder
   uint locked;       // Is the lock held?
 
   // For debugging:
@@ -7,5 +9,9 @@ struct spinlock {
   struct cpu *cpu;   // The cpu holding the lock.
   uint pcs[10];      // The call stack (an array of program counters)
                      // that locked the lock.
+
+  // For lockstat:
+  int class;         // Index of the lock's class (its name)
+  uint tacquire;     // rdtsc() when acquired
 };
 
@@ -103,10 +103,27 @@ extern int sys_unlink(void);
 extern int sys_wait(void);
 extern int sys_write(void);
 extern int sys_uptime(void);
+extern int sys_getreadcount(void);
+extern int sys_trace(void);
 
 extern int sys_waitx(void);
 extern int sys_setgroup(void);
 extern int sys_getgroup(void);
+extern int sys_lockstat(void);
+extern int sys_profctl(void);
+extern int sys_profread(void);
+extern int sys_sysstat(void);
+extern int sys_ringsetup(void);
+extern int sys_ringenter(void);
+extern int sys_fcntl(void);
+extern int sys_splice(void);
+extern int sys_copyfile(void);
+extern int sys_pread(void);
+extern int sys_pwrite(void);
+extern int sys_readv(void);
+extern int sys_writev(void);
+extern int sys_klogctl(void);
+extern int sys_klogread(void);
 
 
 static int (*syscalls[])(void) = {
@@ -131,20 +148,40 @@ static int (*syscalls[])(void) = {
 [SYS_link]    sys_link,
 [SYS_mkdir]   sys_mkdir,
 [SYS_close]   sys_close,
+[SYS_getreadcount] sys_getreadcount,
+[SYS_trace]   sys_trace,
 [SYS_waitx]    sys_waitx,
 [SYS_setgroup] sys_setgroup,
 [SYS_getgroup] sys_getgroup,
+[SYS_lockstat] sys_lockstat,
+[SYS_profctl]  sys_profctl,
+[SYS_profread] sys_profread,
+[SYS_sysstat]  sys_sysstat,
+[SYS_ringsetup] sys_ringsetup,
+[SYS_ringenter] sys_ringenter,
+[SYS_fcntl]    sys_fcntl,
+[SYS_splice]   sys_splice,
+[SYS_copyfile] sys_copyfile,
+[SYS_pread]    sys_pread,
+[SYS_pwrite]   sys_pwrite,
+[SYS_readv]    sys_readv,
+[SYS_writev]   sys_writev,
+[SYS_klogctl]  sys_klogctl,
+[SYS_klogread] sys_klogread,
 };
 
 void
 syscall(void)
 {
   int num;
+  uint t0;
   struct proc *curproc = myproc();
 
   num = curproc->tf->eax;
   if(num > 0 && num < NELEM(syscalls) && syscalls[num]) {
+    t0 = rdtsc();
     curproc->tf->eax = syscalls[num]();
+    systrace(curproc, num, rdtsc() - t0);
   } else {
     cprintf("%d %s: unknown sys call %d\n",
             curproc->pid, curproc->name, num);
@@ -20,6 +20,23 @@
 #define SYS_link   19
 #define SYS_mkdir  20
 #define SYS_close  21
+#define SYS_getreadcount 22
+#define SYS_trace  23
 #define SYS_waitx    24
 #define SYS_setgroup 25
 #define SYS_getgroup 26
+#define SYS_lockstat 27
+#define SYS_profctl  28
+#define SYS_profread 29
+#define SYS_sysstat  30
+#define SYS_ringsetup 31
+#define SYS_ringenter 32
+#define SYS_fcntl    33
+#define SYS_splice   34
+#define SYS_copyfile 35
+#define SYS_pread    36
+#define SYS_pwrite   37
+#define SYS_readv    38
+#define SYS_writev   39
+#define SYS_klogctl  40
+#define SYS_klogread 41
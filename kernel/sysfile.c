@@ -8,6 +8,7 @@
 #include "defs.h"
 #include "param.h"
 #include "stat.h"
+#include "memlayout.h"
 #include "mmu.h"
 #include "proc.h"
 #include "fs.h"
@@ -15,6 +16,8 @@
 #include "sleeplock.h"
 #include "file.h"
 #include "fcntl.h"
+#include "ring.h"
+#include "uio.h"
 
 // Fetch the nth word-sized system call argument as a file descriptor
 // and return both the descriptor and the corresponding struct file.
@@ -26,7 +29,7 @@ argfd(int n, int *pfd, struct file **pf)
 
   if(argint(n, &fd) < 0)
     return -1;
-  if(fd < 0 || fd >= NOFILE || (f=myproc()->ofile[fd]) == 0)
+  if(fd < 0 || fd >= myproc()->nofile || (f=myproc()->ofile[fd]) == 0)
     return -1;
   if(pfd)
     *pfd = fd;
@@ -43,13 +46,16 @@ fdalloc(struct file *f)
   int fd;
   struct proc *curproc = myproc();
 
-  for(fd = 0; fd < NOFILE; fd++){
+  for(fd = 0; fd < curproc->nofile; fd++){
     if(curproc->ofile[fd] == 0){
       curproc->ofile[fd] = f;
       return fd;
     }
   }
-  return -1;
+  if(growofile(curproc) < 0)
+    return -1;
+  curproc->ofile[fd] = f;
+  return fd;
 }
 
 int
@@ -90,6 +96,89 @@ sys_write(void)
   return filewrite(f, p, n);
 }
 
+// Read or write at an explicit offset, leaving f->off alone.
+int
+sys_pread(void)
+{
+  struct file *f;
+  struct iovec iov;
+  int off;
+
+  if(argfd(0, 0, &f) < 0 || argint(2, &iov.iov_len) < 0 ||
+     argptr(1, (char**)&iov.iov_base, iov.iov_len) < 0 || argint(3, &off) < 0)
+    return -1;
+  if(off < 0)
+    return -1;
+  return filereadv(f, &iov, 1, off);
+}
+
+int
+sys_pwrite(void)
+{
+  struct file *f;
+  struct iovec iov;
+  int off;
+
+  if(argfd(0, 0, &f) < 0 || argint(2, &iov.iov_len) < 0 ||
+     argptr(1, (char**)&iov.iov_base, iov.iov_len) < 0 || argint(3, &off) < 0)
+    return -1;
+  if(off < 0)
+    return -1;
+  return filewritev(f, &iov, 1, off);
+}
+
+// Fetch the iovec array that is the nth system call argument,
+// with its length as argument n+1, into iov, checking that
+// every buffer lies within the process.  Returns the count.
+static int
+argiov(int n, struct iovec *iov)
+{
+  struct iovec *uiov;
+  struct proc *curproc = myproc();
+  int i, cnt;
+  uint tot, base;
+
+  if(argint(n+1, &cnt) < 0 || cnt < 0 || cnt > UIO_MAXIOV)
+    return -1;
+  if(argptr(n, (char**)&uiov, cnt*sizeof(*uiov)) < 0)
+    return -1;
+  tot = 0;
+  for(i = 0; i < cnt; i++){
+    iov[i] = uiov[i];
+    base = (uint)iov[i].iov_base;
+    if(iov[i].iov_len < 0 || base >= curproc->sz ||
+       base + iov[i].iov_len > curproc->sz)
+      return -1;
+    if((tot += iov[i].iov_len) > curproc->sz)
+      return -1;
+  }
+  return cnt;
+}
+
+int
+sys_readv(void)
+{
+  struct file *f;
+  struct iovec iov[UIO_MAXIOV];
+  int cnt;
+
+  if(argfd(0, 0, &f) < 0 || (cnt = argiov(1, iov)) < 0)
+    return -1;
+  return filereadv(f, iov, cnt, -1);
+}
+
+int
+sys_writev(void)
+{
+  struct file *f;
+  struct iovec iov[UIO_MAXIOV];
+  int cnt;
+
+  if(argfd(0, 0, &f) < 0 || (cnt = argiov(1, iov)) < 0)
+    return -1;
+  return filewritev(f, iov, cnt, -1);
+}
+
 int
 sys_close(void)
 {
@@ -103,6 +192,44 @@ sys_close(void)
   return 0;
 }
 
+int
+sys_fcntl(void)
+{
+  struct file *f;
+  int cmd, arg;
+
+  if(argfd(0, 0, &f) < 0 || argint(1, &cmd) < 0 || argint(2, &arg) < 0)
+    return -1;
+  return filefcntl(f, cmd, arg);
+}
+
+// Move up to n bytes between a pipe and a file without
+// copying through user memory.
+int
+sys_splice(void)
+{
+  struct file *in, *out;
+  int n;
+
+  if(argfd(0, 0, &in) < 0 || argfd(1, 0, &out) < 0 || argint(2, &n) < 0)
+    return -1;
+  return filesplice(in, out, n);
+}
+
+// Copy n bytes from offset off of one file to the current
+// offset of another, without copying through user memory.
+int
+sys_copyfile(void)
+{
+  struct file *src, *dst;
+  int off, n;
+
+  if(argfd(0, 0, &src) < 0 || argfd(1, 0, &dst) < 0 ||
+     argint(2, &off) < 0 || argint(3, &n) < 0)
+    return -1;
+  return filecopy(src, dst, off, n);
+}
+
 int
 sys_fstat(void)
 {
@@ -185,7 +312,6 @@ int
 sys_unlink(void)
 {
   struct inode *ip, *dp;
-  struct dirent de;
   char name[DIRSIZ], *path;
   uint off;
 
@@ -215,9 +341,7 @@ sys_unlink(void)
     goto bad;
   }
 
-  memset(&de, 0, sizeof(de));
-  if(writei(dp, (char*)&de, off, sizeof(de)) != sizeof(de))
-    panic("unlink: writei");
+  dirunlink(dp, name, off);
   if(ip->type == T_DIR){
     dp->nlink--;
     iupdate(dp);
@@ -257,7 +381,7 @@ create(char *path, short type, short major, short minor)
     return 0;
   }
 
-  if((ip = ialloc(dp->dev, type)) == 0)
+  if((ip = ialloc(dp->dev, type, dp->inum)) == 0)
     panic("create: ialloc");
 
   ilock(ip);
@@ -442,3 +566,82 @@ sys_pipe(void)
   fd[1] = fd1;
   return 0;
 }
+
+// Map a system call ring into the calling process, if it
+// does not have one yet, and return its address.
+int
+sys_ringsetup(void)
+{
+  struct proc *curproc = myproc();
+  char *mem;
+
+  if(curproc->ring)
+    return URING;
+  if((mem = kalloc()) == 0)
+    return -1;
+  memset(mem, 0, PGSIZE);
+  if(mapupage(curproc->pgdir, URING, mem, PTE_W) < 0){
+    kfree(mem);
+    return -1;
+  }
+  curproc->ring = (struct ring*)mem;
+  return URING;
+}
+
+// Run one queued ring operation, returning what the
+// corresponding system call would.
+static int
+ringop(struct ringsqe *e)
+{
+  struct proc *curproc = myproc();
+  struct file *f;
+
+  if(e->op == RING_NOP)
+    return 0;
+  if(e->fd < 0 || e->fd >= curproc->nofile || (f=curproc->ofile[e->fd]) == 0)
+    return -1;
+  switch(e->op){
+  case RING_READ:
+  case RING_WRITE:
+    if(e->n < 0 || e->addr >= curproc->sz || e->addr+e->n > curproc->sz)
+      return -1;
+    if(e->op == RING_READ)
+      return fileread(f, (char*)e->addr, e->n);
+    return filewrite(f, (char*)e->addr, e->n);
+  case RING_CLOSE:
+    curproc->ofile[e->fd] = 0;
+    fileclose(f);
+    return 0;
+  }
+  return -1;
+}
+
+// Run the operations queued on the calling process's ring
+// in order, posting a completion for each.  Stops early if
+// the completion queue is full.  Returns the number run.
+int
+sys_ringenter(void)
+{
+  struct proc *curproc = myproc();
+  struct ring *r;
+  struct ringsqe e;
+  struct ringcqe *c;
+  int n;
+
+  if((r = curproc->ring) == 0)
+    return -1;
+  if(r->stail - r->shead > NRING)
+    return -1;
+  for(n = 0; r->shead != r->stail && r->ctail - r->chead < NRING; n++){
+    if(curproc->killed)
+      break;
+    // Copy the entry; the process owns the queue memory.
+    e = r->sq[r->shead % NRING];
+    c = &r->cq[r->ctail % NRING];
+    c->data = e.data;
+    c->res = ringop(&e);
+    r->ctail++;
+    r->shead++;
+  }
+  return n;
+}
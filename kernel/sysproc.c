@@ -6,6 +6,10 @@
 #include "memlayout.h"
 #include "mmu.h"
 #include "proc.h"
+#include "lockstat.h"
+#include "prof.h"
+#include "klog.h"
+#include "systrace.h"
 
 int
 sys_fork(void)
@@ -116,3 +120,105 @@ sys_setgroup(void) {
   if (argint(1, &gid) < 0) return -1;
   return setgroup_k(pid, gid); // implementa en proc.c: busca proc y setea p->gid
 }
+
+// Copy statistics for up to n lock classes into the
+// user's array; returns the number of classes copied.
+int
+sys_lockstat(void)
+{
+  struct lockstat *st;
+  int n;
+
+  if(argint(1, &n) < 0 || n < 0)
+    return -1;
+  if(n > NLOCKCLASS)    // and so n*sizeof(*st) cannot overflow
+    n = NLOCKCLASS;
+  if(argptr(0, (void*)&st, n*sizeof(*st)) < 0)
+    return -1;
+  return lockstats(st, n);
+}
+
+int
+sys_profctl(void)
+{
+  int cmd;
+
+  if(argint(0, &cmd) < 0)
+    return -1;
+  return profctl(cmd);
+}
+
+// Move up to n profiler samples into the user's array;
+// returns the number moved.
+int
+sys_profread(void)
+{
+  struct profsample *s;
+  int n;
+
+  if(argint(1, &n) < 0 || n < 0)
+    return -1;
+  if(n > NCPU*NPROFSAMPLE)  // and so n*sizeof(*s) cannot overflow
+    n = NCPU*NPROFSAMPLE;
+  if(argptr(0, (void*)&s, n*sizeof(*s)) < 0)
+    return -1;
+  return profread(s, n);
+}
+
+int
+sys_klogctl(void)
+{
+  int cmd, arg;
+
+  if(argint(0, &cmd) < 0 || argint(1, &arg) < 0)
+    return -1;
+  return klogctl(cmd, arg);
+}
+
+// Move up to n kernel log records after record number last
+// into the user's array; returns the number moved.
+int
+sys_klogread(void)
+{
+  struct klogrec *r;
+  int last, n;
+
+  if(argint(0, &last) < 0 || argint(2, &n) < 0 || n < 0)
+    return -1;
+  if(n > NCPU*NKLOG)    // and so n*sizeof(*r) cannot overflow
+    n = NCPU*NKLOG;
+  if(argptr(1, (void*)&r, n*sizeof(*r)) < 0)
+    return -1;
+  return klogread(last, r, n);
+}
+
+int
+sys_getreadcount(void)
+{
+  return readcount();
+}
+
+int
+sys_trace(void)
+{
+  int pid;
+
+  if(argint(0, &pid) < 0)
+    return -1;
+  return trace(pid);
+}
+
+// Copy system call statistics for traced process pid,
+// or for the whole system if pid is 0.
+int
+sys_sysstat(void)
+{
+  struct sysstat *st;
+  int pid;
+
+  if(argint(0, &pid) < 0)
+    return -1;
+  if(argptr(1, (void*)&st, sizeof(*st)) < 0)
+    return -1;
+  return sysstat(pid, st);
+}
@@ -0,0 +1,148 @@
+// System call counts and latency histograms.
+//
+// syscall() times every handler with rdtsc and calls
+// systrace() with the result.  Each CPU keeps its own global
+// statistics, updated with interrupts off, so the common path
+// takes no lock; readers just add up the CPUs.
+//
+// A process can also be traced: trace() gives it a
+// struct systrace, which its later children share through
+// fork(), collecting statistics for that process tree alone.
+// Tracing lasts until the process is freed; the buffer goes
+// away with the last process sharing it.  p->trace changes
+// only under ptable.lock and only from 0, so syscall() may
+// read its own without locking.
+
+#include "types.h"
+#include "defs.h"
+#include "param.h"
+#include "memlayout.h"
+#include "mmu.h"
+#include "proc.h"
+#include "spinlock.h"
+#include "syscall.h"
+#include "systrace.h"
+
+struct systrace {
+  struct spinlock lock;
+  int ref;
+  struct sysstat st;
+};
+
+static struct sysstat cpustat[NCPU];
+
+static void
+account(struct syscount *c, uint cycles)
+{
+  int b;
+
+  c->count++;
+  c->cycles16 += cycles >> 4;
+  if(cycles > c->maxcycles)
+    c->maxcycles = cycles;
+  for(b = 0; b < NSYSHIST-1 && cycles >= (1 << (SYSHIST_MIN+b)); b++)
+    ;
+  c->hist[b]++;
+}
+
+// Record that p's system call num took cycles.
+void
+systrace(struct proc *p, int num, uint cycles)
+{
+  struct systrace *t;
+
+  if(num >= NSYSCALL)
+    return;
+  pushcli();
+  account(&cpustat[cpuid()].sc[num], cycles);
+  popcli();
+
+  if((t = p->trace) != 0){
+    acquire(&t->lock);
+    account(&t->st.sc[num], cycles);
+    release(&t->lock);
+  }
+}
+
+// Return a new, empty trace buffer with one reference.
+struct systrace*
+systrace_alloc(void)
+{
+  struct systrace *t;
+
+  if(sizeof(*t) > PGSIZE)
+    panic("systrace_alloc");
+  if((t = (struct systrace*)kalloc()) == 0)
+    return 0;
+  memset(t, 0, sizeof(*t));
+  initlock(&t->lock, "systrace");
+  t->ref = 1;
+  return t;
+}
+
+// Take another reference to t, which may be 0.
+struct systrace*
+systrace_dup(struct systrace *t)
+{
+  if(t){
+    acquire(&t->lock);
+    t->ref++;
+    release(&t->lock);
+  }
+  return t;
+}
+
+// Drop a reference to t, which may be 0.
+void
+systrace_put(struct systrace *t)
+{
+  int ref;
+
+  if(t == 0)
+    return;
+  acquire(&t->lock);
+  ref = --t->ref;
+  release(&t->lock);
+  if(ref == 0)
+    kfree((char*)t);
+}
+
+// Copy t's statistics, or the global ones if t is 0, to st.
+void
+systrace_read(struct systrace *t, struct sysstat *st)
+{
+  int i, j, b;
+  struct syscount *c, *d;
+
+  if(t){
+    acquire(&t->lock);
+    *st = t->st;
+    release(&t->lock);
+    return;
+  }
+  memset(st, 0, sizeof(*st));
+  for(i = 0; i < ncpu; i++){
+    for(j = 0; j < NSYSCALL; j++){
+      c = &cpustat[i].sc[j];
+      d = &st->sc[j];
+      d->count += c->count;
+      d->cycles16 += c->cycles16;
+      if(c->maxcycles > d->maxcycles)
+        d->maxcycles = c->maxcycles;
+      for(b = 0; b < NSYSHIST; b++)
+        d->hist[b] += c->hist[b];
+    }
+  }
+}
+
+// Number of read system calls completed since boot.
+int
+readcount(void)
+{
+  int i, n;
+
+  n = 0;
+  for(i = 0; i < ncpu; i++)
+    n += cpustat[i].sc[SYS_read].count;
+  return n;
+}
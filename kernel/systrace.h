@@ -0,0 +1,17 @@
+// System call statistics, as returned by the sysstat system call.
+// Latencies are in TSC cycles, measured around the handler.
+
+#define NSYSCALL    64    // slots, indexed by system call number
+#define NSYSHIST    12    // latency histogram buckets
+#define SYSHIST_MIN 8     // bucket 0 is < 2^8 cycles, bucket i < 2^(8+i)
+
+struct syscount {
+  uint count;              // Completed calls
+  uint cycles16;           // Total cycles / 16 (wraps; use differences)
+  uint maxcycles;          // Slowest call
+  uint hist[NSYSHIST];     // Calls by latency; last bucket is open-ended
+};
+
+struct sysstat {
+  struct syscount sc[NSYSCALL];
+};
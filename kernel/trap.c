@@ -48,12 +48,16 @@ trap(struct trapframe *tf)
 
   switch(tf->trapno){
   case T_IRQ0 + IRQ_TIMER:
+    profsample(tf);
     if(cpuid() == 0){
       acquire(&tickslock);
       ticks++;
+      vdsotick(ticks);
       wakeup(&ticks);
       release(&tickslock);
       tick_accounting();
+      logtick(ticks);
+      klogflush();
     }
     lapiceoi();
     break;
@@ -1,4 +1,12 @@
 // Intel 8250 serial port (UART).
+//
+// Output goes through a transmit ring: uartputc() appends a
+// byte and returns, and the transmitter-empty interrupt sends
+// the rest, a FIFO-full at a time on a 16550.  The interrupt
+// is enabled only while the ring holds bytes.  Writers that
+// may sleep queue with uartputs(), which takes only what
+// fits, and call uartwait() to block, rather than spin, while
+// the ring is full.
 
 #include "types.h"
 #include "defs.h"
@@ -14,15 +22,32 @@
 
 #define COM1    0x3f8
 
+#define UART_TX_BUF 1024
+
+#define IER_RX  0x01    // interrupt when a byte arrives
+#define IER_TX  0x02    // interrupt when the transmitter is empty
+
 static int uart;    // is there a uart?
+static int txfifo;  // bytes to send per transmitter-empty
+
+static struct {
+  struct spinlock lock;
+  char buf[UART_TX_BUF];
+  uint r;           // next byte to send
+  uint w;           // next free slot
+  int ier;          // current interrupt enable register
+} tx;
 
 void
 uartinit(void)
 {
   char *p;
 
-  // Turn off the FIFO
-  outb(COM1+2, 0);
+  initlock(&tx.lock, "uart");
+
+  // Turn on and clear the FIFOs, with a receive trigger level
+  // of one byte; an 8250 without FIFOs ignores this.
+  outb(COM1+2, 0x07);
 
   // 9600 baud, 8 data bits, 1 stop bit, parity off.
   outb(COM1+3, 0x80);    // Unlock divisor
@@ -30,13 +55,17 @@ uartinit(void)
   outb(COM1+1, 0);
   outb(COM1+3, 0x03);    // Lock divisor, 8 data bits.
   outb(COM1+4, 0);
-  outb(COM1+1, 0x01);    // Enable receive interrupts.
+  tx.ier = IER_RX;
+  outb(COM1+1, tx.ier);  // Enable receive interrupts.
 
   // If status is 0xFF, no serial port.
   if(inb(COM1+5) == 0xFF)
     return;
   uart = 1;
 
+  // A 16550 reports working FIFOs in the top bits of the IIR.
+  txfifo = (inb(COM1+2) & 0xC0) == 0xC0 ? 16 : 1;
+
   // Acknowledge pre-existing interrupt conditions;
   // enable interrupts.
   inb(COM1+2);
@@ -48,18 +77,96 @@ uartinit(void)
     uartputc(*p);
 }
 
+// Send buffered bytes if the transmitter is empty, and leave
+// the transmitter-empty interrupt enabled only if some remain.
+// Caller must hold tx.lock.
+static void
+uartstart(void)
+{
+  int i, ier;
+
+  if(tx.r != tx.w && (inb(COM1+5) & 0x20))
+    for(i = 0; i < txfifo && tx.r != tx.w; i++)
+      outb(COM1+0, tx.buf[tx.r++ % UART_TX_BUF]);
+
+  ier = tx.r != tx.w ? IER_RX|IER_TX : IER_RX;
+  if(ier != tx.ier){
+    tx.ier = ier;
+    outb(COM1+1, ier);
+  }
+}
+
+// Queue c for output.  Never sleeps, so it is safe in
+// interrupt handlers; if the ring is full, drain it by polling.
 void
 uartputc(int c)
+{
+  if(!uart)
+    return;
+  acquire(&tx.lock);
+  while(tx.w - tx.r == UART_TX_BUF)
+    uartstart();
+  tx.buf[tx.w++ % UART_TX_BUF] = c;
+  uartstart();
+  release(&tx.lock);
+}
+
+// Send c without the lock or the ring, for panic(), after
+// flushing whatever is queued.  The lock may be held by a
+// CPU that will never release it.
+void
+uartputc_sync(int c)
 {
   int i;
 
   if(!uart)
     return;
+  while(tx.r != tx.w){
+    for(i = 0; i < 128 && !(inb(COM1+5) & 0x20); i++)
+      microdelay(10);
+    outb(COM1+0, tx.buf[tx.r++ % UART_TX_BUF]);
+  }
   for(i = 0; i < 128 && !(inb(COM1+5) & 0x20); i++)
     microdelay(10);
   outb(COM1+0, c);
 }
 
+// Queue as many of the n bytes at s as the ring has room
+// for, without sleeping or polling.  Returns the number
+// queued, which is 0 only if the ring is full.
+int
+uartputs(char *s, int n)
+{
+  int i;
+
+  if(!uart)
+    return n;
+  acquire(&tx.lock);
+  for(i = 0; i < n && tx.w - tx.r < UART_TX_BUF; i++)
+    tx.buf[tx.w++ % UART_TX_BUF] = s[i];
+  uartstart();
+  release(&tx.lock);
+  return i;
+}
+
+// Sleep until the ring has room.  Returns -1 if killed.
+int
+uartwait(void)
+{
+  if(!uart)
+    return 0;
+  acquire(&tx.lock);
+  while(tx.w - tx.r == UART_TX_BUF){
+    if(myproc()->killed){
+      release(&tx.lock);
+      return -1;
+    }
+    sleep(&tx.r, &tx.lock);
+  }
+  release(&tx.lock);
+  return 0;
+}
+
 static int
 uartgetc(void)
 {
@@ -74,4 +181,13 @@ void
 uartintr(void)
 {
   consoleintr(uartgetc);
+
+  // Nothing else is locked here, so waking writers is safe;
+  // uartputc() may run under locks that wakeup() needs.
+  if(!uart)
+    return;
+  acquire(&tx.lock);
+  uartstart();
+  wakeup(&tx.r);
+  release(&tx.lock);
 }
@@ -0,0 +1,8 @@
+// Buffers for vectored I/O (readv and writev).
+
+#define UIO_MAXIOV 32   // most buffers in one call
+
+struct iovec {
+  void *iov_base;
+  int iov_len;
+};
@@ -0,0 +1,66 @@
+// Kernel-maintained pages mapped read-only into user space.
+//
+// uptime() and getpid() are cheap questions, but as system
+// calls they cost a trap each, and uptime() also takes
+// tickslock, which timing loops hammer.  Instead the kernel
+// publishes the answers: one vtime page, shared by every
+// process and updated on each tick, and one vproc page per
+// address space.  ulib.c reads them directly.
+//
+// vproc pages belong to the page table, like user memory;
+// the vtime page must outlive them all, so freevm() unmaps
+// it before freeing the rest.
+
+#include "types.h"
+#include "defs.h"
+#include "param.h"
+#include "memlayout.h"
+#include "mmu.h"
+#include "x86.h"
+#include "vdso.h"
+
+static struct vtime *vtime;
+
+void
+vdsoinit(void)
+{
+  if((vtime = (struct vtime*)kalloc()) == 0)
+    panic("vdsoinit");
+  memset(vtime, 0, PGSIZE);
+}
+
+// Publish a new tick count.  Called by CPU 0's timer
+// interrupt after advancing ticks.
+void
+vdsotick(uint ticks)
+{
+  uint tsc;
+
+  tsc = rdtsc();
+  vtime->seq++;
+  __sync_synchronize();
+  if(vtime->tsc)
+    vtime->tscpertick = tsc - vtime->tsc;
+  vtime->tsc = tsc;
+  vtime->ticks = ticks;
+  __sync_synchronize();
+  vtime->seq++;
+}
+
+// Map the vtime page and a fresh vproc page for pid into pgdir.
+// On failure the caller frees pgdir as usual.
+int
+mapvdso(pde_t *pgdir, int pid)
+{
+  struct vproc *vp;
+
+  if((vp = (struct vproc*)kalloc()) == 0)
+    return -1;
+  memset(vp, 0, PGSIZE);
+  vp->pid = pid;
+  if(mapupage(pgdir, VPROC, (char*)vp, 0) < 0){
+    kfree((char*)vp);
+    return -1;
+  }
+  return mapupage(pgdir, VTIME, (char*)vtime, 0);
+}
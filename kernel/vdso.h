@@ -0,0 +1,18 @@
+// Read-only pages the kernel maps into every process, so that
+// user code can read the time and its pid without a system
+// call.  See VTIME and VPROC in memlayout.h.
+
+// Shared by all processes; updated by CPU 0's timer interrupt.
+// ticks alone can be read directly.  To read tsc consistently
+// with it, retry while seq is odd or changes across the read.
+struct vtime {
+  uint seq;          // Odd while an update is in progress
+  uint ticks;        // Same as the uptime system call
+  uint tsc;          // Low TSC word when ticks last advanced
+  uint tscpertick;   // TSC cycles between the last two ticks
+};
+
+// Private to each process.
+struct vproc {
+  int pid;
+};
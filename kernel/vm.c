@@ -224,7 +224,7 @@ allocuvm(pde_t *pgdir, uint oldsz, uint newsz)
   char *mem;
   uint a;
 
-  if(newsz >= KERNBASE)
+  if(newsz > USERTOP)
     return 0;
   if(newsz < oldsz)
     return oldsz;
@@ -278,15 +278,27 @@ deallocuvm(pde_t *pgdir, uint oldsz, uint newsz)
   return newsz;
 }
 
+// Map the kernel page mem at user address va in pgdir.
+// freevm() frees it along with the rest of the user memory.
+int
+mapupage(pde_t *pgdir, uint va, char *mem, int perm)
+{
+  return mappages(pgdir, (char*)va, PGSIZE, V2P(mem), perm|PTE_U);
+}
+
 // Free a page table and all the physical memory pages
 // in the user part.
 void
 freevm(pde_t *pgdir)
 {
   uint i;
+  pte_t *pte;
 
   if(pgdir == 0)
     panic("freevm: no pgdir");
+  // The shared vtime page is not ours to free.
+  if((pte = walkpgdir(pgdir, (char*)VTIME, 0)) != 0)
+    *pte = 0;
   deallocuvm(pgdir, KERNBASE, 0);
   for(i = 0; i < NPDENTRIES; i++){
     if(pgdir[i] & PTE_P){
@@ -130,6 +130,23 @@ xchg(volatile uint *addr, uint newval)
   return result;
 }
 
+// Low 32 bits of the time-stamp counter; differences of
+// two readings are exact for intervals under 2^32 cycles.
+static inline uint
+rdtsc(void)
+{
+  uint lo, hi;
+
+  asm volatile("rdtsc" : "=a" (lo), "=d" (hi));
+  return lo;
+}
+
+static inline void
+pause(void)
+{
+  asm volatile("pause");
+}
+
 static inline uint
 rcr2(void)
 {
@@ -15,14 +15,16 @@
 #define static_assert(a, b) do { switch (0) case 0: case (a): ; } while (0)
 #endif
 
-#define NINODES 200
+#define NINODES 1024
+#define GROUPSIZE 2048  // blocks per allocation group
 
 // Disk layout:
-// [ boot block | sb block | log | inode blocks | free bit map | data blocks ]
+// [ boot block | sb block | log | group 0 | group 1 | ... ]
+// where each group is [ free bit map | inode blocks | data blocks ]
 
-int nbitmap = FSSIZE/(BSIZE*8) + 1;
-int ninodeblocks = NINODES / IPB + 1;
 int nlog = LOGSIZE;
+int ngroups;  // Number of allocation groups
+int ipg;      // Inodes per group
 int nmeta;    // Number of meta blocks (boot, sb, nlog, inode, bitmap)
 int nblocks;  // Number of data blocks
 
@@ -34,6 +36,7 @@ uint freeblock;
 
 
 void balloc(int);
+uint newblock(void);
 void wsect(uint, void*);
 void winode(uint, struct dinode*);
 void rinode(uint inum, struct dinode *ip);
@@ -83,6 +86,8 @@ main(int argc, char *argv[])
 
   assert((BSIZE % sizeof(struct dinode)) == 0);
   assert((BSIZE % sizeof(struct dirent)) == 0);
+  assert(nlog - 1 <= MAXLOGBLOCKS);
+  assert(GROUPSIZE <= BPB);
 
   fsfd = open(argv[1], O_RDWR|O_CREAT|O_TRUNC, 0666);
   if(fsfd < 0){
@@ -90,23 +95,32 @@ main(int argc, char *argv[])
     exit(1);
   }
 
-  // 1 fs block = 1 disk sector
-  nmeta = 2 + nlog + ninodeblocks + nbitmap;
+  // Split the blocks after the log into groups, and the
+  // inodes evenly among them.
+  ngroups = (FSSIZE - 2 - nlog + GROUPSIZE - 1) / GROUPSIZE;
+  ipg = (NINODES + ngroups - 1) / ngroups;
+  ipg = (ipg + IPB - 1) / IPB * IPB;
+  nmeta = 2 + nlog + ngroups * (1 + ipg / IPB);
   nblocks = FSSIZE - nmeta;
 
   //sb.magic = FSMAGIC;
   sb.size = xint(FSSIZE);
   sb.nblocks = xint(nblocks);
-  sb.ninodes = xint(NINODES);
+  sb.ninodes = xint(ngroups * ipg);
   sb.nlog = xint(nlog);
   sb.logstart = xint(2);
-  sb.inodestart = xint(2+nlog);
-  sb.bmapstart = xint(2+nlog+ninodeblocks);
+  sb.ngroups = xint(ngroups);
+  sb.groupstart = xint(2+nlog);
+  sb.groupsize = xint(GROUPSIZE);
+  sb.ipg = xint(ipg);
 
-  printf("nmeta %d (boot, super, log blocks %u inode blocks %u, bitmap blocks %u) blocks %d total %d\n",
-         nmeta, nlog, ninodeblocks, nbitmap, nblocks, FSSIZE);
+  // The last group may be short, but must hold some data.
+  assert(GDATA(ngroups - 1, sb) < FSSIZE);
 
-  freeblock = nmeta;     // the first free block that we can allocate
+  printf("nmeta %d (boot, super, log blocks %u, %d groups of %u blocks with %u inode blocks) blocks %d total %d\n",
+         nmeta, nlog, ngroups, GROUPSIZE, (uint)(ipg / IPB), nblocks, FSSIZE);
+
+  freeblock = GDATA(0, sb);     // the first free block that we can allocate
 
   for(i = 0; i < FSSIZE; i++)
     wsect(i, zeroes);
@@ -129,14 +143,12 @@ main(int argc, char *argv[])
   iappend(rootino, &de, sizeof(de));
 
   for(i = 2; i < argc; i++){
-    // get rid of "user/"
+    // get rid of directory prefixes such as "user/"
     char *shortname;
-    if(strncmp(argv[i], "user/", 5) == 0)
-      shortname = argv[i] + 5;
+    if((shortname = rindex(argv[i], '/')) != 0)
+      shortname++;
     else
       shortname = argv[i];
-    
-    assert(index(shortname, '/') == 0);
 
     if((fd = open(argv[i], 0)) < 0){
       perror(argv[i]);
@@ -242,20 +254,41 @@ ialloc(ushort type)
   return inum;
 }
 
+// Return the next unused data block, skipping the bit map
+// and inode blocks at the start of each group.
+uint
+newblock(void)
+{
+  uint b;
+
+  b = freeblock++;
+  if(BBIT(b, sb) == 0){
+    b = GDATA(BGROUP(b, sb), sb);
+    freeblock = b + 1;
+  }
+  assert(b < FSSIZE);
+  return b;
+}
+
+// Write each group's free bit map, marking its bit map and
+// inode blocks and the data blocks below used.
 void
 balloc(int used)
 {
   uchar buf[BSIZE];
-  int i;
+  uint g, i, b;
 
   printf("balloc: first %d blocks have been allocated\n", used);
-  assert(used < BSIZE*8);
-  bzero(buf, BSIZE);
-  for(i = 0; i < used; i++){
-    buf[i/8] = buf[i/8] | (0x1 << (i%8));
+  for(g = 0; g < ngroups; g++){
+    bzero(buf, BSIZE);
+    for(i = 0; i < GROUPSIZE && GSTART(g, sb) + i < FSSIZE; i++){
+      b = GSTART(g, sb) + i;
+      if(b < GDATA(g, sb) || b < used)
+        buf[i/8] = buf[i/8] | (0x1 << (i%8));
+    }
+    wsect(GSTART(g, sb), buf);
   }
-  printf("balloc: write bitmap block at sector %d\n", sb.bmapstart);
-  wsect(sb.bmapstart, buf);
+  printf("balloc: wrote %d bitmap blocks\n", ngroups);
 }
 
 #define min(a, b) ((a) < (b) ? (a) : (b))
@@ -264,7 +297,7 @@ void
 iappend(uint inum, void *xp, int n)
 {
   char *p = (char*)xp;
-  uint fbn, off, n1;
+  uint fbn, dbn, off, n1;
   struct dinode din;
   char buf[BSIZE];
   uint indirect[NINDIRECT];
@@ -278,19 +311,36 @@ iappend(uint inum, void *xp, int n)
     assert(fbn < MAXFILE);
     if(fbn < NDIRECT){
       if(xint(din.addrs[fbn]) == 0){
-        din.addrs[fbn] = xint(freeblock++);
+        din.addrs[fbn] = xint(newblock());
       }
       x = xint(din.addrs[fbn]);
-    } else {
+    } else if(fbn < NDIRECT + NINDIRECT){
       if(xint(din.addrs[NDIRECT]) == 0){
-        din.addrs[NDIRECT] = xint(freeblock++);
+        din.addrs[NDIRECT] = xint(newblock());
       }
       rsect(xint(din.addrs[NDIRECT]), (char*)indirect);
       if(indirect[fbn - NDIRECT] == 0){
-        indirect[fbn - NDIRECT] = xint(freeblock++);
+        indirect[fbn - NDIRECT] = xint(newblock());
         wsect(xint(din.addrs[NDIRECT]), (char*)indirect);
       }
       x = xint(indirect[fbn-NDIRECT]);
+    } else {
+      dbn = fbn - NDIRECT - NINDIRECT;
+      if(xint(din.addrs[NDIRECT+1]) == 0){
+        din.addrs[NDIRECT+1] = xint(newblock());
+      }
+      rsect(xint(din.addrs[NDIRECT+1]), (char*)indirect);
+      if(indirect[dbn / NINDIRECT] == 0){
+        indirect[dbn / NINDIRECT] = xint(newblock());
+        wsect(xint(din.addrs[NDIRECT+1]), (char*)indirect);
+      }
+      x = xint(indirect[dbn / NINDIRECT]);
+      rsect(x, (char*)indirect);
+      if(indirect[dbn % NINDIRECT] == 0){
+        indirect[dbn % NINDIRECT] = xint(newblock());
+        wsect(x, (char*)indirect);
+      }
+      x = xint(indirect[dbn % NINDIRECT]);
     }
     n1 = min(n, (fbn + 1) * BSIZE - off);
     rsect(x, buf);
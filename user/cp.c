@@ -0,0 +1,75 @@
+// Copy a file, letting the kernel move the data with
+// copyfile() and falling back to read and write for
+// devices.  If the target is a directory, copy into it
+// under the source's name.
+
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "fcntl.h"
+#include "fs.h"
+
+char buf[512];
+
+int
+main(int argc, char *argv[])
+{
+  char path[128], *name, *p;
+  struct stat st;
+  int src, dst, n, off;
+
+  if(argc != 3){
+    printf(2, "Usage: cp source target\n");
+    exit();
+  }
+  if((src = open(argv[1], O_RDONLY)) < 0 || fstat(src, &st) < 0){
+    printf(2, "cp: cannot open %s\n", argv[1]);
+    exit();
+  }
+  if(st.type == T_DIR){
+    printf(2, "cp: %s is a directory\n", argv[1]);
+    exit();
+  }
+
+  name = argv[2];
+  if(stat(name, &st) >= 0 && st.type == T_DIR){
+    for(p = argv[1] + strlen(argv[1]); p > argv[1] && p[-1] != '/'; p--)
+      ;
+    if(strlen(name) + 1 + strlen(p) + 1 > sizeof(path)){
+      printf(2, "cp: path too long\n");
+      exit();
+    }
+    strcpy(path, name);
+    name = path + strlen(path);
+    *name++ = '/';
+    strcpy(name, p);
+    name = path;
+  }
+  // There is no O_TRUNC; start from an empty file.
+  if(stat(name, &st) >= 0 && st.type == T_FILE)
+    unlink(name);
+  if((dst = open(name, O_CREATE | O_WRONLY)) < 0){
+    printf(2, "cp: cannot create %s\n", name);
+    exit();
+  }
+
+  fstat(src, &st);
+  n = -1;
+  off = 0;
+  if(st.type == T_FILE)
+    for(n = 0; off < st.size; off += n)
+      if((n = copyfile(src, dst, off, st.size - off)) <= 0)
+        break;
+  if(off == 0 && n < 0){
+    while((n = read(src, buf, sizeof(buf))) > 0)
+      if(write(dst, buf, n) != n){
+        printf(2, "cp: write error\n");
+        exit();
+      }
+  } else if(off < st.size){
+    printf(2, "cp: copy of %s failed\n", argv[1]);
+  }
+  close(src);
+  close(dst);
+  exit();
+}
@@ -0,0 +1,93 @@
+// Create, reopen and remove many files in one directory,
+// reporting the ticks spent in each phase.  With a linear
+// directory scan each phase is quadratic in the number of
+// files; with the dirhash index it should be close to linear.
+//
+// Usage: dirbench [nfiles]
+
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "fcntl.h"
+
+static char *dir = "dirbench.d";
+
+// Set name to "f" followed by the decimal digits of i.
+static void
+mkname(char *name, int i)
+{
+  char digits[10];
+  int n;
+
+  n = 0;
+  do {
+    digits[n++] = '0' + i % 10;
+    i /= 10;
+  } while(i > 0);
+  *name++ = 'f';
+  while(n > 0)
+    *name++ = digits[--n];
+  *name = 0;
+}
+
+int
+main(int argc, char *argv[])
+{
+  char name[16];
+  int i, n, fd, t0, tc, to, tu;
+
+  n = 800;
+  if(argc > 1)
+    n = atoi(argv[1]);
+
+  if(mkdir(dir) < 0 || chdir(dir) < 0){
+    printf(2, "dirbench: cannot make %s\n", dir);
+    exit();
+  }
+
+  t0 = uptime();
+  for(i = 0; i < n; i++){
+    mkname(name, i);
+    if((fd = open(name, O_CREATE | O_RDWR)) < 0){
+      printf(2, "dirbench: create %s failed\n", name);
+      exit();
+    }
+    close(fd);
+  }
+  tc = uptime() - t0;
+
+  t0 = uptime();
+  for(i = n - 1; i >= 0; i--){
+    mkname(name, i);
+    if((fd = open(name, O_RDONLY)) < 0){
+      printf(2, "dirbench: open %s failed\n", name);
+      exit();
+    }
+    close(fd);
+  }
+  if(open("missing", O_RDONLY) >= 0){
+    printf(2, "dirbench: opened a missing file\n");
+    exit();
+  }
+  to = uptime() - t0;
+
+  t0 = uptime();
+  for(i = 0; i < n; i++){
+    mkname(name, i);
+    if(unlink(name) < 0){
+      printf(2, "dirbench: unlink %s failed\n", name);
+      exit();
+    }
+  }
+  tu = uptime() - t0;
+
+  chdir("..");
+  if(unlink(dir) < 0){
+    printf(2, "dirbench: cannot remove %s\n", dir);
+    exit();
+  }
+
+  printf(1, "dirbench: %d files, create %d open %d unlink %d ticks\n",
+         n, tc, to, tu);
+  exit();
+}
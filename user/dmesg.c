@@ -0,0 +1,62 @@
+// Print the kernel log.
+//
+// Usage: dmesg [-c]        print the log; -c then clears it
+//        dmesg -w          print the log and wait for more
+//        dmesg -on | -off  copy new messages to the console
+
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "klog.h"
+
+#define NREC 16
+
+static struct klogrec rec[NREC];
+
+// Print records after last; return the last one printed.
+static uint
+show(uint last)
+{
+  int i, n;
+
+  while((n = klogread(last, rec, NREC)) > 0){
+    for(i = 0; i < n; i++){
+      if(last != 0 && rec[i].seq != last + 1)
+        printf(1, "(%d messages lost)\n", rec[i].seq - last - 1);
+      printf(1, "[%d] cpu%d: %s\n", rec[i].ticks, rec[i].cpu, rec[i].text);
+      last = rec[i].seq;
+    }
+  }
+  return last;
+}
+
+int
+main(int argc, char *argv[])
+{
+  uint last;
+
+  if(argc == 2 && strcmp(argv[1], "-on") == 0){
+    klogctl(KLOG_CONSOLE, 0);
+    exit();
+  }
+  if(argc == 2 && strcmp(argv[1], "-off") == 0){
+    klogctl(KLOG_QUIET, 0);
+    exit();
+  }
+
+  if(argc > 2 || (argc == 2 && strcmp(argv[1], "-c") != 0 && strcmp(argv[1], "-w") != 0)){
+    printf(2, "usage: dmesg [-c | -w | -on | -off]\n");
+    exit();
+  }
+
+  last = show(0);
+  if(argc == 2 && strcmp(argv[1], "-c") == 0)
+    klogctl(KLOG_CLEAR, last);
+  if(argc == 2 && strcmp(argv[1], "-w") == 0){
+    for(;;){
+      sleep(10);
+      last = show(last);
+    }
+  }
+  exit();
+}
@@ -0,0 +1,162 @@
+// Age the file system by repeatedly creating files of random
+// sizes in a few directories and deleting a random half of
+// them, then time how long it takes to write and read a big
+// file and to read every surviving small file.  Aging
+// fragments free space; a locality-aware allocator should
+// keep the read times close to those on a fresh disk.
+//
+// Usage: fsage [rounds]
+
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "fcntl.h"
+
+#define NDIR   4
+#define NFILE  160
+#define MAXKB  16
+#define BIGKB  1024
+
+static char buf[1024];
+static int exists[NFILE];
+static uint seed = 1;
+
+static uint
+rand(void)
+{
+  seed = seed * 1103515245 + 12345;
+  return (seed >> 16) & 0x7fff;
+}
+
+// Set path to "ageD/fN" for file i, which lives in directory i % NDIR.
+static void
+mkpath(char *path, int i)
+{
+  char *p;
+  int n;
+
+  p = path;
+  memmove(p, "age", 3);
+  p += 3;
+  *p++ = '0' + i % NDIR;
+  *p++ = '/';
+  *p++ = 'f';
+  n = i;
+  if(n >= 100)
+    *p++ = '0' + n / 100;
+  if(n >= 10)
+    *p++ = '0' + n / 10 % 10;
+  *p++ = '0' + n % 10;
+  *p = 0;
+}
+
+static void
+writefile(char *path, int kb)
+{
+  int fd, i;
+
+  if((fd = open(path, O_CREATE | O_RDWR)) < 0){
+    printf(2, "fsage: create %s failed\n", path);
+    exit();
+  }
+  for(i = 0; i < kb; i++){
+    if(write(fd, buf, sizeof(buf)) != sizeof(buf)){
+      printf(2, "fsage: write %s failed\n", path);
+      exit();
+    }
+  }
+  close(fd);
+}
+
+static int
+readfile(char *path)
+{
+  int fd, n, tot;
+
+  if((fd = open(path, O_RDONLY)) < 0){
+    printf(2, "fsage: open %s failed\n", path);
+    exit();
+  }
+  tot = 0;
+  while((n = read(fd, buf, sizeof(buf))) > 0)
+    tot += n;
+  close(fd);
+  return tot;
+}
+
+int
+main(int argc, char *argv[])
+{
+  char path[16], dir[8];
+  int rounds, r, i, k, t0, tw, tr, ts, nsmall;
+
+  rounds = 8;
+  if(argc > 1)
+    rounds = atoi(argv[1]);
+  memset(buf, 'x', sizeof(buf));
+
+  for(i = 0; i < NDIR; i++){
+    memmove(dir, "age0", 5);
+    dir[3] += i;
+    if(mkdir(dir) < 0){
+      printf(2, "fsage: mkdir %s failed\n", dir);
+      exit();
+    }
+  }
+
+  // Age: fill the empty slots, then delete about half.
+  for(r = 0; r < rounds; r++){
+    for(i = 0; i < NFILE; i++){
+      if(exists[i])
+        continue;
+      mkpath(path, i);
+      writefile(path, 1 + rand() % MAXKB);
+      exists[i] = 1;
+    }
+    for(k = 0; k < NFILE / 2; k++){
+      i = rand() % NFILE;
+      if(!exists[i])
+        continue;
+      mkpath(path, i);
+      unlink(path);
+      exists[i] = 0;
+    }
+  }
+
+  t0 = uptime();
+  writefile("age0/big", BIGKB);
+  tw = uptime() - t0;
+
+  t0 = uptime();
+  readfile("age0/big");
+  tr = uptime() - t0;
+
+  t0 = uptime();
+  nsmall = 0;
+  for(i = 0; i < NFILE; i++){
+    if(!exists[i])
+      continue;
+    mkpath(path, i);
+    readfile(path);
+    nsmall++;
+  }
+  ts = uptime() - t0;
+
+  // Clean up.
+  unlink("age0/big");
+  for(i = 0; i < NFILE; i++){
+    if(exists[i]){
+      mkpath(path, i);
+      unlink(path);
+    }
+  }
+  for(i = 0; i < NDIR; i++){
+    memmove(dir, "age0", 5);
+    dir[3] += i;
+    unlink(dir);
+  }
+
+  printf(1, "fsage: %d rounds; big file write %d read %d ticks; %d small files read %d ticks\n",
+         rounds, tw, tr, nsmall, ts);
+  exit();
+}
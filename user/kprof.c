@@ -0,0 +1,183 @@
+// Flat kernel profile: sample every CPU on each timer tick
+// while a command runs (or for a number of ticks), then
+// attribute kernel samples to functions using /kernel.sym.
+//
+// Usage: kprof [-n top] command [args...]
+//        kprof [-n top] -t ticks
+
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "fcntl.h"
+#include "prof.h"
+
+#define MAXSAMPLE (8*4096)
+
+struct sym {
+  uint addr;
+  char *name;
+  int count;
+};
+
+static struct sym *syms;
+static int nsym;
+
+static uint
+hex(char *s, char **end)
+{
+  uint x;
+
+  for(x = 0; ; s++){
+    if(*s >= '0' && *s <= '9')
+      x = x*16 + *s - '0';
+    else if(*s >= 'a' && *s <= 'f')
+      x = x*16 + *s - 'a' + 10;
+    else
+      break;
+  }
+  *end = s;
+  return x;
+}
+
+// Load "address name" lines from path, sorted by address.
+static void
+loadsyms(char *path)
+{
+  struct stat st;
+  struct sym t;
+  char *buf, *p, *q;
+  int fd, n, i, j, gap;
+
+  if((fd = open(path, O_RDONLY)) < 0 || fstat(fd, &st) < 0){
+    printf(2, "kprof: cannot read %s\n", path);
+    exit();
+  }
+  buf = malloc(st.size + 1);
+  for(n = 0; n < st.size; n += i)
+    if((i = read(fd, buf + n, st.size - n)) <= 0)
+      break;
+  buf[n] = 0;
+  close(fd);
+
+  syms = malloc(sizeof(struct sym) * (n / 10 + 1));
+  for(p = buf; *p; p = q){
+    for(q = p; *q && *q != '\n'; q++)
+      ;
+    if(*q)
+      *q++ = 0;
+    t.addr = hex(p, &p);
+    if(t.addr == 0 || *p != ' ')  // source file names
+      continue;
+    t.name = p + 1;
+    t.count = 0;
+    syms[nsym++] = t;
+  }
+
+  for(gap = nsym/2; gap > 0; gap /= 2)
+    for(i = gap; i < nsym; i++)
+      for(j = i - gap; j >= 0 && syms[j].addr > syms[j+gap].addr; j -= gap){
+        t = syms[j];
+        syms[j] = syms[j+gap];
+        syms[j+gap] = t;
+      }
+}
+
+// Return the symbol containing addr, or 0.
+static struct sym*
+lookup(uint addr)
+{
+  int lo, hi, mid;
+
+  lo = 0;
+  hi = nsym - 1;
+  if(nsym == 0 || addr < syms[0].addr)
+    return 0;
+  while(lo < hi){
+    mid = (lo + hi + 1) / 2;
+    if(syms[mid].addr <= addr)
+      lo = mid;
+    else
+      hi = mid - 1;
+  }
+  return &syms[lo];
+}
+
+int
+main(int argc, char *argv[])
+{
+  struct profsample *s;
+  struct sym *sym, t;
+  int top, ticks, pid, n, k, i, j, nuser, nother, total;
+
+  top = 20;
+  ticks = 0;
+  while(argc > 1 && argv[1][0] == '-'){
+    if(argc > 2 && strcmp(argv[1], "-n") == 0)
+      top = atoi(argv[2]);
+    else if(argc > 2 && strcmp(argv[1], "-t") == 0)
+      ticks = atoi(argv[2]);
+    else
+      break;
+    argc -= 2;
+    argv += 2;
+  }
+  if(argc < 2 && ticks <= 0){
+    printf(2, "usage: kprof [-n top] command [args...]\n"
+              "       kprof [-n top] -t ticks\n");
+    exit();
+  }
+
+  loadsyms("/kernel.sym");
+  s = malloc(sizeof(*s) * MAXSAMPLE);
+
+  if(profctl(PROF_START) < 0){
+    printf(2, "kprof: cannot start profiling\n");
+    exit();
+  }
+  if(ticks > 0){
+    sleep(ticks);
+  } else {
+    if((pid = fork()) < 0){
+      printf(2, "kprof: fork failed\n");
+      exit();
+    }
+    if(pid == 0){
+      exec(argv[1], argv + 1);
+      printf(2, "kprof: exec %s failed\n", argv[1]);
+      exit();
+    }
+    wait();
+  }
+  profctl(PROF_STOP);
+
+  n = 0;
+  while(n < MAXSAMPLE && (k = profread(s + n, MAXSAMPLE - n)) > 0)
+    n += k;
+
+  nuser = nother = 0;
+  for(i = 0; i < n; i++){
+    if(s[i].user)
+      nuser++;
+    else if((sym = lookup(s[i].eip)) != 0)
+      sym->count++;
+    else
+      nother++;
+  }
+
+  // Sort by count, most frequent first.
+  for(i = 1; i < nsym; i++)
+    for(j = i; j > 0 && syms[j-1].count < syms[j].count; j--){
+      t = syms[j];
+      syms[j] = syms[j-1];
+      syms[j-1] = t;
+    }
+
+  total = n ? n : 1;
+  printf(1, "%d samples (%d user, %d dropped)\n", n, nuser, profctl(PROF_DROPPED));
+  printf(1, "samples\t%%\tfunction\n");
+  for(i = 0; i < nsym && i < top && syms[i].count > 0; i++)
+    printf(1, "%d\t%d\t%s\n", syms[i].count, syms[i].count * 100 / total, syms[i].name);
+  if(nother)
+    printf(1, "%d\t%d\t(unknown)\n", nother, nother * 100 / total);
+  exit();
+}
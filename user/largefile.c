@@ -0,0 +1,100 @@
+// Write and read back a file large enough to need the
+// doubly-indirect block, checking every byte and reporting
+// the ticks spent in each phase.
+//
+// Usage: largefile [kbytes]
+
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "fs.h"
+#include "fcntl.h"
+
+#define CHUNK 4096
+
+static char buf[CHUNK];
+
+// Byte i of the file; varies with the block number so that
+// misplaced blocks are caught, not just missing ones.
+static char
+pattern(uint i)
+{
+  return (char)(i ^ (i / BSIZE) * 7);
+}
+
+int
+main(int argc, char *argv[])
+{
+  char *path = "largefile.tmp";
+  uint size, off, kb, maxkb;
+  int fd, i, n, t0, tw, tr;
+  struct stat st;
+
+  // In KB, since MAXFILE*BSIZE bytes overflows with 4KB
+  // blocks; the size must also fit in a uint.
+  maxkb = (uint)MAXFILE * (BSIZE / 512) / 2;
+  if(maxkb >= 4*1024*1024)
+    maxkb = 4*1024*1024 - 1;
+  kb = 6 * 1024;
+  if(argc > 1)
+    kb = atoi(argv[1]);
+  if(kb > maxkb){
+    printf(2, "largefile: at most %d KB per file\n", maxkb);
+    exit();
+  }
+  size = kb * 1024;
+
+  fd = open(path, O_CREATE | O_RDWR);
+  if(fd < 0){
+    printf(2, "largefile: cannot create %s\n", path);
+    exit();
+  }
+  t0 = uptime();
+  for(off = 0; off < size; off += n){
+    n = size - off < CHUNK ? size - off : CHUNK;
+    for(i = 0; i < n; i++)
+      buf[i] = pattern(off + i);
+    if(write(fd, buf, n) != n){
+      printf(2, "largefile: write failed at %d\n", off);
+      exit();
+    }
+  }
+  close(fd);
+  tw = uptime() - t0;
+
+  if(stat(path, &st) < 0){
+    printf(2, "largefile: cannot stat %s\n", path);
+    exit();
+  }
+  if(st.size != size){
+    printf(2, "largefile: size %d, expected %d\n", st.size, size);
+    exit();
+  }
+
+  fd = open(path, O_RDONLY);
+  t0 = uptime();
+  for(off = 0; off < size; off += n){
+    n = size - off < CHUNK ? size - off : CHUNK;
+    if(read(fd, buf, n) != n){
+      printf(2, "largefile: read failed at %d\n", off);
+      exit();
+    }
+    for(i = 0; i < n; i++){
+      if(buf[i] != pattern(off + i)){
+        printf(2, "largefile: bad data at %d\n", off + i);
+        exit();
+      }
+    }
+  }
+  close(fd);
+  tr = uptime() - t0;
+
+  if(unlink(path) < 0){
+    printf(2, "largefile: unlink failed\n");
+    exit();
+  }
+
+  printf(1, "largefile: %d KB, write %d ticks, read %d ticks, ok\n",
+         kb, tw, tr);
+  exit();
+}
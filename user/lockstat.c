@@ -0,0 +1,57 @@
+// Print kernel spinlock statistics, one line per lock class.
+// With a command, run it and print only the activity while it
+// ran (the longest hold is still the all-time one).
+//
+// Usage: lockstat [command [args...]]
+
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "lockstat.h"
+
+static struct lockstat before[NLOCKCLASS], after[NLOCKCLASS];
+
+int
+main(int argc, char *argv[])
+{
+  int i, j, n0, n, pid;
+  struct lockstat *a, *b;
+
+  n0 = lockstat(before, NLOCKCLASS);
+  if(argc > 1){
+    pid = fork();
+    if(pid < 0){
+      printf(2, "lockstat: fork failed\n");
+      exit();
+    }
+    if(pid == 0){
+      exec(argv[1], argv + 1);
+      printf(2, "lockstat: exec %s failed\n", argv[1]);
+      exit();
+    }
+    wait();
+  } else {
+    n0 = 0;
+  }
+  n = lockstat(after, NLOCKCLASS);
+
+  printf(1, "%s\t\t%s\t%s\t%s\t%s\n", "lock", "acquire", "contend", "spins", "maxhold");
+  for(i = 0; i < n; i++){
+    a = &after[i];
+    // Classes keep their slots, but new ones may appear.
+    for(j = 0; j < n0; j++){
+      b = &before[j];
+      if(strcmp(a->name, b->name) == 0){
+        a->nacquire -= b->nacquire;
+        a->ncontended -= b->ncontended;
+        a->nspin -= b->nspin;
+        break;
+      }
+    }
+    if(a->nacquire == 0)
+      continue;
+    printf(1, "%s\t%s%d\t%d\t%d\t%d\n", a->name, strlen(a->name) < 8 ? "\t" : "",
+           a->nacquire, a->ncontended, a->nspin, a->maxhold);
+  }
+  exit();
+}
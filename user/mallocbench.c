@@ -0,0 +1,96 @@
+// Time malloc and free: first allocate many small blocks and
+// free them in random order, then churn a set of live blocks
+// of mixed sizes by replacing random ones.  Each block is
+// filled and checked before it is freed.
+//
+// Usage: mallocbench [rounds]
+
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+
+#define NLIVE  2000
+#define NCHURN 50000
+#define MAXSMALLSZ 256
+#define MAXBIGSZ   4096
+
+static char *blk[NLIVE];
+static uint len[NLIVE];
+static int order[NLIVE];
+static uint seed = 1;
+
+static uint
+rand(void)
+{
+  seed = seed * 1103515245 + 12345;
+  return (seed >> 16) & 0x7fff;
+}
+
+static void
+get(int i, uint n)
+{
+  if((blk[i] = malloc(n)) == 0){
+    printf(2, "mallocbench: malloc %d failed\n", n);
+    exit();
+  }
+  len[i] = n;
+  memset(blk[i], i & 0xff, n);
+}
+
+static void
+put(int i)
+{
+  uint k;
+
+  for(k = 0; k < len[i]; k++){
+    if((uchar)blk[i][k] != (i & 0xff)){
+      printf(2, "mallocbench: block %d corrupted\n", i);
+      exit();
+    }
+  }
+  free(blk[i]);
+  blk[i] = 0;
+}
+
+int
+main(int argc, char *argv[])
+{
+  int rounds, r, i, j, k, t0, tsmall, tchurn;
+
+  rounds = argc > 1 ? atoi(argv[1]) : 10;
+
+  // Small blocks, freed in a shuffled order.
+  t0 = uptime();
+  for(r = 0; r < rounds; r++){
+    for(i = 0; i < NLIVE; i++)
+      get(i, 1 + rand() % MAXSMALLSZ);
+    for(i = 0; i < NLIVE; i++)
+      order[i] = i;
+    for(i = NLIVE - 1; i > 0; i--){
+      j = rand() % (i + 1);
+      k = order[i];
+      order[i] = order[j];
+      order[j] = k;
+    }
+    for(i = 0; i < NLIVE; i++)
+      put(order[i]);
+  }
+  tsmall = uptime() - t0;
+
+  // Mixed sizes, mostly small, replaced at random.
+  t0 = uptime();
+  for(i = 0; i < NLIVE; i++)
+    get(i, rand() % 8 ? 1 + rand() % MAXSMALLSZ : 1 + rand() % MAXBIGSZ);
+  for(r = 0; r < rounds * NCHURN / 10; r++){
+    i = rand() % NLIVE;
+    put(i);
+    get(i, rand() % 8 ? 1 + rand() % MAXSMALLSZ : 1 + rand() % MAXBIGSZ);
+  }
+  for(i = 0; i < NLIVE; i++)
+    put(i);
+  tchurn = uptime() - t0;
+
+  printf(1, "mallocbench: %d rounds; small %d ticks, churn %d ticks\n",
+         rounds, tsmall, tchurn);
+  exit();
+}
@@ -1,14 +1,18 @@
 #define NPROC        64  // maximum number of processes
 #define KSTACKSIZE 4096  // size of per-process kernel stack
 #define NCPU          8  // maximum number of CPUs
-#define NOFILE       16  // open files per process
-#define NFILE       100  // open files per system
-#define NINODE       50  // maximum number of active i-nodes
+#define NOFILE       16  // open files per process before its table grows
+#define MAXOFILE   1024  // open files per process (a page of pointers)
+#define NFILE      4096  // open files per system, allocated as needed
+#define NINODE      200  // size of inode cache
+#define NDENTRY     256  // size of directory entry cache
 #define NDEV         10  // maximum major device number
 #define ROOTDEV       1  // device number of file system root disk
 #define MAXARG       32  // max exec arguments
-#define MAXOPBLOCKS  10  // max # of blocks any FS op writes
-#define LOGSIZE      (MAXOPBLOCKS*3)  // max data blocks in on-disk log
-#define NBUF         (MAXOPBLOCKS*3)  // size of disk block cache
-#define FSSIZE       1000  // size of file system in blocks
+#define MAXOPBLOCKS  16  // max # of blocks any FS op writes
+#ifndef LOGSIZE
+#define LOGSIZE      (MAXOPBLOCKS*7)  // blocks in the on-disk log made by mkfs
+#endif
+#define NBUF         (LOGSIZE+MAXOPBLOCKS*3)  // size of disk block cache
+#define FSSIZE       20000  // size of file system in blocks
 
@@ -0,0 +1,97 @@
+// Push data through a shell-style pipeline of processes, each
+// stage copying its input to its output in 512-byte pieces
+// like cat, and report the ticks it took.  -s sets the
+// capacity of every pipe with fcntl.
+//
+// Usage: pipeline [-s pipesize] [stages [KB]]
+
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "fcntl.h"
+
+static char buf[512];
+
+// Copy fd in to fd out until end of file; return bytes copied.
+static int
+copy(int in, int out)
+{
+  int n, tot;
+
+  tot = 0;
+  while((n = read(in, buf, sizeof(buf))) > 0){
+    if(out >= 0 && write(out, buf, n) != n){
+      printf(2, "pipeline: write failed\n");
+      exit();
+    }
+    tot += n;
+  }
+  return tot;
+}
+
+int
+main(int argc, char *argv[])
+{
+  int stages, kb, size, psize, i, in, fd[2], t0, n;
+
+  size = 0;
+  if(argc > 2 && strcmp(argv[1], "-s") == 0){
+    size = atoi(argv[2]);
+    argc -= 2;
+    argv += 2;
+  }
+  stages = argc > 1 ? atoi(argv[1]) : 3;
+  kb = argc > 2 ? atoi(argv[2]) : 2048;
+  if(stages < 1){
+    printf(2, "usage: pipeline [-s pipesize] [stages [KB]]\n");
+    exit();
+  }
+
+  t0 = uptime();
+
+  // Each stage reads from in and writes to a new pipe;
+  // the first stage generates the data.
+  in = -1;
+  for(i = 0; i < stages; i++){
+    if(pipe(fd) < 0){
+      printf(2, "pipeline: pipe failed\n");
+      exit();
+    }
+    if(size > 0)
+      psize = fcntl(fd[1], F_SETPIPE_SZ, size);
+    else
+      psize = fcntl(fd[1], F_GETPIPE_SZ, 0);
+    if(psize < 0){
+      printf(2, "pipeline: cannot set pipe size %d\n", size);
+      exit();
+    }
+    if(fork() == 0){
+      close(fd[0]);
+      if(in < 0){
+        memset(buf, 'p', sizeof(buf));
+        for(n = 0; n < kb*2; n++)
+          write(fd[1], buf, sizeof(buf));
+      } else {
+        copy(in, fd[1]);
+      }
+      exit();
+    }
+    close(fd[1]);
+    if(in >= 0)
+      close(in);
+    in = fd[0];
+  }
+
+  n = copy(in, -1);
+  close(in);
+  for(i = 0; i < stages; i++)
+    wait();
+
+  if(n != kb*1024){
+    printf(2, "pipeline: received %d bytes, expected %d\n", n, kb*1024);
+    exit();
+  }
+  printf(1, "pipeline: %d KB through %d stages, pipe size %d: %d ticks\n",
+         kb, stages, psize, uptime() - t0);
+  exit();
+}
@@ -0,0 +1,64 @@
+// Stream data from a child through one pipe and report the
+// throughput in MB/s (taking a tick to be 10ms).
+//
+// Usage: pipespeed [MB [chunk]]
+
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+
+#define MAXMB 2047  // so that the byte count fits in an int
+
+static char buf[16*1024];
+
+int
+main(int argc, char *argv[])
+{
+  int mb, chunk, fd[2], n, t, i;
+  uint total, left, size;
+
+  mb = argc > 1 ? atoi(argv[1]) : 256;
+  chunk = argc > 2 ? atoi(argv[2]) : 4096;
+  if(mb <= 0 || mb > MAXMB || chunk <= 0 || chunk > sizeof(buf)){
+    printf(2, "usage: pipespeed [MB [chunk]], MB at most %d, chunk at most %d\n",
+           MAXMB, sizeof(buf));
+    exit();
+  }
+  size = mb*1024*1024;
+  if(pipe(fd) < 0){
+    printf(2, "pipespeed: pipe failed\n");
+    exit();
+  }
+
+  t = uptime();
+  if(fork() == 0){
+    close(fd[0]);
+    for(i = 0; i < sizeof(buf); i++)
+      buf[i] = i;
+    for(left = size; left > 0; left -= n){
+      n = left < chunk ? left : chunk;
+      if(write(fd[1], buf, n) != n){
+        printf(2, "pipespeed: write failed\n");
+        exit();
+      }
+    }
+    exit();
+  }
+  close(fd[1]);
+  total = 0;
+  while((n = read(fd[0], buf, chunk)) > 0)
+    total += n;
+  close(fd[0]);
+  wait();
+  t = uptime() - t;
+
+  if(total != size){
+    printf(2, "pipespeed: received %d bytes, expected %d\n", total, size);
+    exit();
+  }
+  if(t == 0)
+    t = 1;
+  printf(1, "pipespeed: %d MB in %d-byte chunks, %d ticks, %d MB/s\n",
+         mb, chunk, t, mb*100/t);
+  exit();
+}
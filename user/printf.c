@@ -1,15 +1,70 @@
+// printf collects its output in a per-fd buffer instead of
+// making a write system call per character.  By default the
+// buffer is written at the end of each printf call, so output
+// appears exactly when it did before; printfmode() can defer
+// the write to each newline or to a full buffer, and fflush()
+// writes a buffer out early.  exit(), fork() and exec() in
+// ulib.c flush every buffer first, so nothing is lost or
+// printed twice.
+
 #include "types.h"
 #include "stat.h"
 #include "user.h"
 
+#define NPRINTFD  8     // fds with their own buffer
+#define PRINTFBUF 512
+
+struct outbuf {
+  int fd;
+  int mode;             // PRINTF_CALL, PRINTF_LINE or PRINTF_FULL
+  int n;                // bytes waiting
+  char buf[PRINTFBUF];
+};
+
+static struct outbuf outbuf[NPRINTFD];
+static struct outbuf other;   // for higher fds; always PRINTF_CALL
+
+static void
+flushbuf(struct outbuf *b)
+{
+  if(b->n > 0)
+    write(b->fd, b->buf, b->n);
+  b->n = 0;
+}
+
+// Write out fd's buffered output, or every buffer if fd < 0.
+void
+fflush(int fd)
+{
+  int i;
+
+  for(i = 0; i < NPRINTFD; i++)
+    if(fd < 0 || fd == i)
+      flushbuf(&outbuf[i]);
+  if(fd < 0 || fd == other.fd)
+    flushbuf(&other);
+}
+
+// Choose when printf's output to fd is written.
+void
+printfmode(int fd, int mode)
+{
+  if(fd < 0 || fd >= NPRINTFD)
+    return;
+  flushbuf(&outbuf[fd]);
+  outbuf[fd].mode = mode;
+}
+
 static void
-putc(int fd, char c)
+putc(struct outbuf *b, char c)
 {
-  write(fd, &c, 1);
+  b->buf[b->n++] = c;
+  if(b->n == PRINTFBUF || (c == '\n' && b->mode == PRINTF_LINE))
+    flushbuf(b);
 }
 
 static void
-printint(int fd, int xx, int base, int sgn)
+printint(struct outbuf *b, int xx, int base, int sgn)
 {
   static char digits[] = "0123456789ABCDEF";
   char buf[16];
@@ -32,17 +87,26 @@ printint(int fd, int xx, int base, int sgn)
     buf[i++] = '-';
 
   while(--i >= 0)
-    putc(fd, buf[i]);
+    putc(b, buf[i]);
 }
 
 // Print to the given fd. Only understands %d, %x, %p, %s.
 void
 printf(int fd, const char *fmt, ...)
 {
+  struct outbuf *b;
   char *s;
   int c, i, state;
   uint *ap;
 
+  if(fd >= 0 && fd < NPRINTFD){
+    b = &outbuf[fd];
+  } else {
+    b = &other;
+    b->mode = PRINTF_CALL;
+  }
+  b->fd = fd;
+
   state = 0;
   ap = (uint*)(void*)&fmt + 1;
   for(i = 0; fmt[i]; i++){
@@ -51,14 +115,14 @@ printf(int fd, const char *fmt, ...)
       if(c == '%'){
         state = '%';
       } else {
-        putc(fd, c);
+        putc(b, c);
       }
     } else if(state == '%'){
       if(c == 'd'){
-        printint(fd, *ap, 10, 1);
+        printint(b, *ap, 10, 1);
         ap++;
       } else if(c == 'x' || c == 'p'){
-        printint(fd, *ap, 16, 0);
+        printint(b, *ap, 16, 0);
         ap++;
       } else if(c == 's'){
         s = (char*)*ap;
@@ -66,20 +130,22 @@ printf(int fd, const char *fmt, ...)
         if(s == 0)
           s = "(null)";
         while(*s != 0){
-          putc(fd, *s);
+          putc(b, *s);
           s++;
         }
       } else if(c == 'c'){
-        putc(fd, *ap);
+        putc(b, *ap);
         ap++;
       } else if(c == '%'){
-        putc(fd, c);
+        putc(b, c);
       } else {
         // Unknown % sequence.  Print it to draw attention.
-        putc(fd, '%');
-        putc(fd, c);
+        putc(b, '%');
+        putc(b, c);
       }
       state = 0;
     }
   }
+  if(b->mode == PRINTF_CALL)
+    flushbuf(b);
 }
@@ -0,0 +1,64 @@
+// Helpers for the system call ring: queue operations, run
+// them all with one ringenter(), and collect completions.
+
+#include "types.h"
+#include "user.h"
+#include "ring.h"
+
+// Queue an operation; returns -1 if the submission queue is full.
+static int
+queue(struct ring *r, int op, int fd, void *addr, int n, uint data)
+{
+  struct ringsqe *e;
+
+  if(r->stail - r->shead == NRING)
+    return -1;
+  e = &r->sq[r->stail % NRING];
+  e->op = op;
+  e->fd = fd;
+  e->addr = (uint)addr;
+  e->n = n;
+  e->data = data;
+  r->stail++;
+  return 0;
+}
+
+int
+ringread(struct ring *r, int fd, void *buf, int n, uint data)
+{
+  return queue(r, RING_READ, fd, buf, n, data);
+}
+
+int
+ringwrite(struct ring *r, int fd, void *buf, int n, uint data)
+{
+  return queue(r, RING_WRITE, fd, buf, n, data);
+}
+
+int
+ringclose(struct ring *r, int fd, uint data)
+{
+  return queue(r, RING_CLOSE, fd, 0, 0, data);
+}
+
+// Run everything queued, if anything is.
+// Returns the number of operations run.
+int
+ringsubmit(struct ring *r)
+{
+  if(r->shead == r->stail)
+    return 0;
+  return ringenter();
+}
+
+// Take the oldest completion into *c.
+// Returns 0 if there is none.
+int
+ringreap(struct ring *r, struct ringcqe *c)
+{
+  if(r->chead == r->ctail)
+    return 0;
+  *c = r->cq[r->chead % NRING];
+  r->chead++;
+  return 1;
+}
@@ -0,0 +1,104 @@
+// Read a file in small chunks, first with one read() system
+// call per chunk and then with batches of reads queued on
+// the system call ring, and report the ticks each took.
+//
+// Usage: ringbench [rounds [chunk]]
+
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "fcntl.h"
+#include "ring.h"
+
+#define FILESIZE (32*1024)
+#define BATCH    64
+
+static char *file = "ringbench.tmp";
+static char buf[BATCH*512];
+
+static int
+openfile(void)
+{
+  int fd;
+
+  if((fd = open(file, O_RDONLY)) < 0){
+    printf(2, "ringbench: open %s failed\n", file);
+    exit();
+  }
+  return fd;
+}
+
+int
+main(int argc, char *argv[])
+{
+  struct ring *r;
+  struct ringcqe c;
+  int rounds, chunk, fd, i, k, n, done, t0, tplain, tring;
+  int nplain, nring, nenter;
+
+  rounds = 20;
+  chunk = 32;
+  if(argc > 1)
+    rounds = atoi(argv[1]);
+  if(argc > 2)
+    chunk = atoi(argv[2]);
+  if(chunk <= 0 || chunk > 512){
+    printf(2, "ringbench: chunk must be 1..512\n");
+    exit();
+  }
+  if((r = ringsetup()) == (struct ring*)-1){
+    printf(2, "ringbench: ringsetup failed\n");
+    exit();
+  }
+
+  memset(buf, 'r', sizeof(buf));
+  if((fd = open(file, O_CREATE | O_RDWR)) < 0){
+    printf(2, "ringbench: create %s failed\n", file);
+    exit();
+  }
+  for(i = 0; i < FILESIZE; i += 512)
+    write(fd, buf, 512);
+  close(fd);
+
+  nplain = 0;
+  t0 = uptime();
+  for(k = 0; k < rounds; k++){
+    fd = openfile();
+    while((n = read(fd, buf, chunk)) > 0)
+      nplain += n;
+    close(fd);
+  }
+  tplain = uptime() - t0;
+
+  nring = nenter = 0;
+  t0 = uptime();
+  for(k = 0; k < rounds; k++){
+    fd = openfile();
+    for(done = 0; !done; ){
+      for(i = 0; i < BATCH; i++)
+        ringread(r, fd, buf + i*chunk, chunk, i);
+      ringsubmit(r);
+      nenter++;
+      while(ringreap(r, &c)){
+        if(c.res <= 0)
+          done = 1;
+        else
+          nring += c.res;
+      }
+    }
+    ringclose(r, fd, 0);
+    ringsubmit(r);
+    while(ringreap(r, &c))
+      ;
+  }
+  tring = uptime() - t0;
+
+  unlink(file);
+  if(nplain != nring){
+    printf(2, "ringbench: read %d bytes plain but %d with the ring\n", nplain, nring);
+    exit();
+  }
+  printf(1, "ringbench: %d rounds of %d-byte reads: syscalls %d ticks, ring %d ticks (%d entries)\n",
+         rounds, chunk, tplain, tring, nenter);
+  exit();
+}
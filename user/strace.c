@@ -0,0 +1,167 @@
+// Summarize the system calls made by a command, or by a
+// running process over some ticks: call counts, mean and
+// maximum latency in cycles and, with -v, latency histograms.
+// With -g, report system-wide counts instead.
+//
+// Usage: strace [-v] command [args...]
+//        strace [-v] -p pid [ticks]
+//        strace [-v] -g [ticks]
+//
+// A traced command's counts include strace's fork and wait
+// and a few calls of its own, which share its trace buffer.
+
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "syscall.h"
+#include "systrace.h"
+
+static char *names[NSYSCALL] = {
+[SYS_fork]    "fork",
+[SYS_exit]    "exit",
+[SYS_wait]    "wait",
+[SYS_pipe]    "pipe",
+[SYS_read]    "read",
+[SYS_kill]    "kill",
+[SYS_exec]    "exec",
+[SYS_fstat]   "fstat",
+[SYS_chdir]   "chdir",
+[SYS_dup]     "dup",
+[SYS_getpid]  "getpid",
+[SYS_sbrk]    "sbrk",
+[SYS_sleep]   "sleep",
+[SYS_uptime]  "uptime",
+[SYS_open]    "open",
+[SYS_write]   "write",
+[SYS_mknod]   "mknod",
+[SYS_unlink]  "unlink",
+[SYS_link]    "link",
+[SYS_mkdir]   "mkdir",
+[SYS_close]   "close",
+[SYS_getreadcount] "getreadcount",
+[SYS_trace]   "trace",
+[SYS_waitx]   "waitx",
+[SYS_setgroup] "setgroup",
+[SYS_getgroup] "getgroup",
+[SYS_lockstat] "lockstat",
+[SYS_profctl]  "profctl",
+[SYS_profread] "profread",
+[SYS_sysstat]  "sysstat",
+[SYS_ringsetup] "ringsetup",
+[SYS_ringenter] "ringenter",
+[SYS_fcntl]    "fcntl",
+[SYS_splice]   "splice",
+[SYS_copyfile] "copyfile",
+[SYS_pread]    "pread",
+[SYS_pwrite]   "pwrite",
+[SYS_readv]    "readv",
+[SYS_writev]   "writev",
+[SYS_klogctl]  "klogctl",
+[SYS_klogread] "klogread",
+};
+
+static struct sysstat before, after;
+
+static void
+usage(void)
+{
+  printf(2, "usage: strace [-v] command [args...]\n"
+            "       strace [-v] -p pid [ticks]\n"
+            "       strace [-v] -g [ticks]\n");
+  exit();
+}
+
+static void
+report(int verbose)
+{
+  struct syscount *a, *b;
+  int i, k;
+
+  printf(1, "syscall\t\tcalls\tavg\tmax\n");
+  for(i = 0; i < NSYSCALL; i++){
+    a = &after.sc[i];
+    b = &before.sc[i];
+    a->count -= b->count;
+    a->cycles16 -= b->cycles16;
+    for(k = 0; k < NSYSHIST; k++)
+      a->hist[k] -= b->hist[k];
+    if(a->count == 0)
+      continue;
+    if(names[i])
+      printf(1, "%s\t%s", names[i], strlen(names[i]) < 8 ? "\t" : "");
+    else
+      printf(1, "#%d\t\t", i);
+    printf(1, "%d\t%d\t%d\n", a->count, a->cycles16 / a->count * 16, a->maxcycles);
+    if(verbose){
+      for(k = 0; k < NSYSHIST; k++){
+        if(a->hist[k] == 0)
+          continue;
+        if(k < NSYSHIST-1)
+          printf(1, "\t< 2^%d\t%d\n", SYSHIST_MIN+k, a->hist[k]);
+        else
+          printf(1, "\t>= 2^%d\t%d\n", SYSHIST_MIN+k-1, a->hist[k]);
+      }
+    }
+  }
+}
+
+int
+main(int argc, char *argv[])
+{
+  int verbose, pid, ticks;
+
+  verbose = 0;
+  if(argc > 1 && strcmp(argv[1], "-v") == 0){
+    verbose = 1;
+    argc--;
+    argv++;
+  }
+  if(argc < 2)
+    usage();
+
+  ticks = 100;
+  if(strcmp(argv[1], "-g") == 0 || strcmp(argv[1], "-p") == 0){
+    pid = 0;
+    if(argv[1][1] == 'p'){
+      if(argc < 3)
+        usage();
+      pid = atoi(argv[2]);
+      argc--;
+      argv++;
+      if(trace(pid) < 0){
+        printf(2, "strace: cannot trace %d\n", pid);
+        exit();
+      }
+    }
+    if(argc > 2)
+      ticks = atoi(argv[2]);
+    if(sysstat(pid, &before) < 0)
+      exit();
+    sleep(ticks);
+    if(sysstat(pid, &after) < 0){
+      printf(2, "strace: process %d is gone\n", pid);
+      exit();
+    }
+    report(verbose);
+    exit();
+  }
+
+  pid = getpid();
+  if(trace(pid) < 0 || sysstat(pid, &before) < 0){
+    printf(2, "strace: cannot trace\n");
+    exit();
+  }
+  if((pid = fork()) < 0){
+    printf(2, "strace: fork failed\n");
+    exit();
+  }
+  if(pid == 0){
+    exec(argv[1], argv + 1);
+    printf(2, "strace: exec %s failed\n", argv[1]);
+    exit();
+  }
+  wait();
+  sysstat(getpid(), &after);
+  report(verbose);
+  exit();
+}
@@ -13,37 +13,56 @@
 #include "fs.h"
 #include "fcntl.h"
 
+// Usage: stressfs [KB [chunk]]
+// Each of the five processes writes KB kilobytes (default 10)
+// in chunk-byte writes (default 512) and reports how long
+// that took; the first also reports the total time.
+static char data[64*1024];
+
 int
 main(int argc, char *argv[])
 {
-  int fd, i;
+  int fd, i, me, kb, chunk, n, t0, tw;
   char path[] = "stressfs0";
-  char data[512];
+
+  kb = argc > 1 ? atoi(argv[1]) : 10;
+  chunk = argc > 2 ? atoi(argv[2]) : 512;
+  if(kb <= 0 || chunk <= 0 || chunk > sizeof(data)){
+    printf(2, "usage: stressfs [KB [chunk]], chunk at most %d\n", sizeof(data));
+    exit();
+  }
 
   printf(1, "stressfs starting\n");
   memset(data, 'a', sizeof(data));
+  t0 = uptime();
 
-  for(i = 0; i < 4; i++)
+  for(me = 0; me < 4; me++)
     if(fork() > 0)
       break;
 
-  printf(1, "write %d\n", i);
+  printf(1, "write %d\n", me);
 
-  path[8] += i;
+  path[8] += me;
   fd = open(path, O_CREATE | O_RDWR);
-  for(i = 0; i < 20; i++)
+  for(i = 0; i < kb*1024; i += n){
+    n = kb*1024 - i < chunk ? kb*1024 - i : chunk;
 //    printf(fd, "%d\n", i);
-    write(fd, data, sizeof(data));
+    write(fd, data, n);
+  }
   close(fd);
+  tw = uptime() - t0;
 
-  printf(1, "read\n");
+  printf(1, "read %d (wrote in %d ticks)\n", me, tw);
 
   fd = open(path, O_RDONLY);
-  for (i = 0; i < 20; i++)
-    read(fd, data, sizeof(data));
+  while(read(fd, data, chunk) > 0)
+    ;
   close(fd);
 
   wait();
 
+  if(me == 0)
+    printf(1, "stressfs: 5 x %d KB in %d-byte writes, all done in %d ticks\n",
+           kb, chunk, uptime() - t0);
   exit();
 }
@@ -5,6 +5,15 @@
 
 // Memory allocator by Kernighan and Ritchie,
 // The C programming Language, 2nd ed.  Section 8.7.
+//
+// Small blocks, of at most MAXSMALL units counting the header,
+// come from segregated free lists, one per size in units, so
+// malloc and free of small blocks are O(1).  An empty list is
+// refilled by carving a SLABUNITS block from the K&R list into
+// blocks of its size.  Small blocks keep their size in their
+// header, which is how free() finds their list; they are never
+// returned to the K&R list.  Larger blocks use the K&R
+// first-fit list as before.
 
 typedef long Align;
 
@@ -18,15 +27,19 @@ union header {
 
 typedef union header Header;
 
+#define MAXSMALL  64    // largest small block, in units
+#define SLABUNITS 512   // units carved per refill
+
 static Header base;
 static Header *freep;
+static Header *bin[MAXSMALL+1];
 
-void
-free(void *ap)
+// Return bp to the K&R list, coalescing with its neighbours.
+static void
+bigfree(Header *bp)
 {
-  Header *bp, *p;
+  Header *p;
 
-  bp = (Header*)ap - 1;
   for(p = freep; !(bp > p && bp < p->s.ptr); p = p->s.ptr)
     if(p >= p->s.ptr && (bp > p || bp < p->s.ptr))
       break;
@@ -56,17 +69,16 @@ morecore(uint nu)
     return 0;
   hp = (Header*)p;
   hp->s.size = nu;
-  free((void*)(hp + 1));
+  bigfree(hp);
   return freep;
 }
 
-void*
-malloc(uint nbytes)
+// First-fit allocation of nunits from the K&R list.
+static Header*
+bigalloc(uint nunits)
 {
   Header *p, *prevp;
-  uint nunits;
 
-  nunits = (nbytes + sizeof(Header) - 1)/sizeof(Header) + 1;
   if((prevp = freep) == 0){
     base.s.ptr = freep = prevp = &base;
     base.s.size = 0;
@@ -81,10 +93,60 @@ malloc(uint nbytes)
         p->s.size = nunits;
       }
       freep = prevp;
-      return (void*)(p + 1);
+      return p;
     }
     if(p == freep)
       if((p = morecore(nunits)) == 0)
         return 0;
   }
 }
+
+// Fill bin[nunits] with blocks carved from one K&R block.
+static int
+refill(uint nunits)
+{
+  Header *slab, *p;
+
+  if((slab = bigalloc(SLABUNITS)) == 0)
+    return -1;
+  // Carve the space after slab's own header.
+  for(p = slab + 1; p + nunits <= slab + SLABUNITS; p += nunits){
+    p->s.size = nunits;
+    p->s.ptr = bin[nunits];
+    bin[nunits] = p;
+  }
+  return 0;
+}
+
+void
+free(void *ap)
+{
+  Header *bp;
+
+  bp = (Header*)ap - 1;
+  if(bp->s.size <= MAXSMALL){
+    bp->s.ptr = bin[bp->s.size];
+    bin[bp->s.size] = bp;
+    return;
+  }
+  bigfree(bp);
+}
+
+void*
+malloc(uint nbytes)
+{
+  Header *p;
+  uint nunits;
+
+  nunits = (nbytes + sizeof(Header) - 1)/sizeof(Header) + 1;
+  if(nunits > MAXSMALL){
+    if((p = bigalloc(nunits)) == 0)
+      return 0;
+    return (void*)(p + 1);
+  }
+  if(bin[nunits] == 0 && refill(nunits) < 0)
+    return 0;
+  p = bin[nunits];
+  bin[nunits] = p->s.ptr;
+  return (void*)(p + 1);
+}
@@ -1,16 +1,23 @@
 struct stat;
 struct rtcdate;
+struct lockstat;
+struct profsample;
+struct sysstat;
+struct ring;
+struct ringcqe;
+struct iovec;
+struct klogrec;
 
 // system calls
-int fork(void);
-int exit(void) __attribute__((noreturn));
+int _fork(void);
+int _exit(void) __attribute__((noreturn));
 int wait(void);
 int pipe(int*);
 int write(int, const void*, int);
 int read(int, void*, int);
 int close(int);
 int kill(int);
-int exec(char*, char**);
+int _exec(char*, char**);
 int open(const char*, int);
 int mknod(const char*, short, short);
 int unlink(const char*);
@@ -19,14 +26,29 @@ int link(const char*, const char*);
 int mkdir(const char*);
 int chdir(const char*);
 int dup(int);
-int getpid(void);
 char* sbrk(int);
 int sleep(int);
-int uptime(void);
 
 int waitx(int *wtime, int *rtime);
 int setgroup(int pid, int gid);
 int getgroup(int pid);
+int lockstat(struct lockstat*, int);
+int profctl(int);
+int profread(struct profsample*, int);
+int getreadcount(void);
+int trace(int);
+int sysstat(int, struct sysstat*);
+struct ring* ringsetup(void);
+int ringenter(void);
+int fcntl(int, int, int);
+int splice(int, int, int);
+int copyfile(int, int, int, int);
+int pread(int, void*, int, int);
+int pwrite(int, const void*, int, int);
+int readv(int, const struct iovec*, int);
+int writev(int, const struct iovec*, int);
+int klogctl(int, uint);
+int klogread(uint, struct klogrec*, int);
 
 // ulib.c
 int stat(const char*, struct stat*);
@@ -41,3 +63,22 @@ void* memset(void*, int, uint);
 void* malloc(uint);
 void free(void*);
 int atoi(const char*);
+int getpid(void);
+int uptime(void);
+int fork(void);
+int exit(void) __attribute__((noreturn));
+int exec(char*, char**);
+
+// printf.c
+#define PRINTF_CALL 0   // write at the end of each printf (default)
+#define PRINTF_LINE 1   // write at each newline
+#define PRINTF_FULL 2   // write when the buffer fills
+void printfmode(int, int);
+void fflush(int);
+
+// ring.c
+int ringread(struct ring*, int, void*, int, uint);
+int ringwrite(struct ring*, int, void*, int, uint);
+int ringclose(struct ring*, int, uint);
+int ringsubmit(struct ring*);
+int ringreap(struct ring*, struct ringcqe*);
@@ -7,6 +7,7 @@
 #include "syscall.h"
 #include "traps.h"
 #include "memlayout.h"
+#include "uio.h"
 
 char buf[8192];
 char name[3];
@@ -184,6 +185,107 @@ writetest(void)
   printf(stdout, "small file test ok\n");
 }
 
+// pread/pwrite at explicit offsets, and readv/writev
+// gathering several buffers.
+void
+prwtest(void)
+{
+  struct iovec iov[3];
+  int fd, i;
+
+  printf(stdout, "pread/pwrite/readv/writev test\n");
+  fd = open("prw", O_CREATE|O_RDWR);
+  if(fd < 0){
+    printf(stdout, "error: creat prw failed!\n");
+    exit();
+  }
+  iov[0].iov_base = "aaaa";
+  iov[0].iov_len = 4;
+  iov[1].iov_base = "";
+  iov[1].iov_len = 0;
+  iov[2].iov_base = "bbbbbb";
+  iov[2].iov_len = 6;
+  if(writev(fd, iov, 3) != 10){
+    printf(stdout, "error: writev failed\n");
+    exit();
+  }
+  if(pwrite(fd, "cc", 2, 3) != 2 || pwrite(fd, "dd", 2, 11) >= 0){
+    printf(stdout, "error: pwrite wrong\n");
+    exit();
+  }
+  // pwrite must not have moved the offset.
+  if(write(fd, "e", 1) != 1){
+    printf(stdout, "error: write after pwrite failed\n");
+    exit();
+  }
+  memset(buf, 0, 16);
+  if(pread(fd, buf, 16, 2) != 9 || strcmp(buf, "accbbbbbe") != 0){
+    printf(stdout, "error: pread got %s\n", buf);
+    exit();
+  }
+  close(fd);
+
+  fd = open("prw", O_RDONLY);
+  memset(buf, 0, 32);
+  iov[0].iov_base = buf;
+  iov[0].iov_len = 3;
+  iov[1].iov_base = buf + 10;
+  iov[1].iov_len = 4;
+  iov[2].iov_base = buf + 20;
+  iov[2].iov_len = 10;
+  if((i = readv(fd, iov, 3)) != 11 || strcmp(buf, "aaa") != 0 ||
+     strcmp(buf + 10, "ccbb") != 0 || strcmp(buf + 20, "bbbe") != 0){
+    printf(stdout, "error: readv returned %d\n", i);
+    exit();
+  }
+  close(fd);
+  unlink("prw");
+  printf(stdout, "pread/pwrite/readv/writev ok\n");
+}
+
+// more descriptors than the initial per-process table holds,
+// inherited across fork.
+void
+manyfds(void)
+{
+  int fd, i, pid;
+
+  printf(stdout, "many fds test\n");
+  if((fd = open("manyfds", O_CREATE|O_RDWR)) < 0){
+    printf(stdout, "error: creat manyfds failed!\n");
+    exit();
+  }
+  for(i = 0; i < 200; i++){
+    if(dup(fd) != fd + 1 + i){
+      printf(stdout, "error: dup %d failed\n", i);
+      exit();
+    }
+  }
+  pid = fork();
+  if(pid == 0){
+    if(write(fd + 200, "x", 1) != 1){
+      printf(stdout, "error: write to inherited fd failed\n");
+      exit();
+    }
+    exit();
+  }
+  wait();
+  for(i = 0; i <= 200; i++)
+    close(fd + i);
+  if((fd = open("manyfds", O_RDONLY)) < 0 || read(fd, buf, 2) != 1){
+    printf(stdout, "error: manyfds not written\n");
+    exit();
+  }
+  close(fd);
+  unlink("manyfds");
+  printf(stdout, "many fds ok\n");
+}
+
+// Number of 512-byte records writetest1 writes: enough to
+// use the direct, singly-indirect and a few doubly-indirect
+// blocks, without filling the disk when MAXFILE is huge.
+#define BIGRECS ((NDIRECT + NINDIRECT + 4) * (BSIZE / 512))
+
 void
 writetest1(void)
 {
@@ -197,7 +299,7 @@ writetest1(void)
     exit();
   }
 
-  for(i = 0; i < MAXFILE; i++){
+  for(i = 0; i < BIGRECS; i++){
     ((int*)buf)[0] = i;
     if(write(fd, buf, 512) != 512){
       printf(stdout, "error: write big file failed\n", i);
@@ -217,7 +319,7 @@ writetest1(void)
   for(;;){
     i = read(fd, buf, 512);
     if(i == 0){
-      if(n == MAXFILE - 1){
+      if(n != BIGRECS){
         printf(stdout, "read only %d blocks from big", n);
         exit();
       }
@@ -1774,6 +1876,8 @@ main(int argc, char *argv[])
   writetest();
   writetest1();
   createtest();
+  prwtest();
+  manyfds();
 
   openiputtest();
   exitiputtest();